@@ -2,12 +2,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
 
-static double elapsed_seconds(struct timeval start, struct timeval end)
+static double elapsed_seconds(int64_t elapsed_ns)
 {
-    struct timeval diff = timeval_sub(end, start);
-    return timeval_to_seconds(diff);
+    return (double)elapsed_ns / 1000000000.0;
 }
 
 static void *xmalloc(size_t size)
@@ -36,8 +34,8 @@ static void bench_strjoin(size_t iterations)
         parts[i] = owned_parts[i];
     }
 
-    struct timeval start, end;
-    gettimeofday(&start, NULL);
+    strap_timer_scope_t scope;
+    strap_timer_region_begin(&scope, "strjoin");
     for (size_t i = 0; i < iterations; ++i)
     {
         char *joined = strjoin(parts, parts_count, ",");
@@ -48,9 +46,9 @@ static void bench_strjoin(size_t iterations)
         }
         free(joined);
     }
-    gettimeofday(&end, NULL);
+    int64_t elapsed_ns = strap_timer_region_end(&scope);
 
-    double secs = elapsed_seconds(start, end);
+    double secs = elapsed_seconds(elapsed_ns);
     printf("strjoin (%zu iterations): %.3f ms\n", iterations, secs * 1000.0);
 
     for (size_t i = 0; i < parts_count; ++i)
@@ -63,9 +61,9 @@ static void bench_strtrim(size_t iterations)
 {
     const char *input = "\t    strap trims strings nicely    \n";
 
-    struct timeval start, end;
+    strap_timer_scope_t scope;
 
-    gettimeofday(&start, NULL);
+    strap_timer_region_begin(&scope, "strtrim");
     for (size_t i = 0; i < iterations; ++i)
     {
         char *trimmed = strtrim(input);
@@ -76,19 +74,19 @@ static void bench_strtrim(size_t iterations)
         }
         free(trimmed);
     }
-    gettimeofday(&end, NULL);
-    double secs = elapsed_seconds(start, end);
+    int64_t elapsed_ns = strap_timer_region_end(&scope);
+    double secs = elapsed_seconds(elapsed_ns);
     printf("strtrim (heap, %zu iterations): %.3f ms\n", iterations, secs * 1000.0);
 
-    gettimeofday(&start, NULL);
+    strap_timer_region_begin(&scope, "strtrim_inplace");
     for (size_t i = 0; i < iterations; ++i)
     {
         char buffer[128];
         strcpy(buffer, input);
         strtrim_inplace(buffer);
     }
-    gettimeofday(&end, NULL);
-    secs = elapsed_seconds(start, end);
+    elapsed_ns = strap_timer_region_end(&scope);
+    secs = elapsed_seconds(elapsed_ns);
     printf("strtrim_inplace (%zu iterations): %.3f ms\n", iterations, secs * 1000.0);
 }
 
@@ -96,8 +94,8 @@ static void bench_strreplace(size_t iterations)
 {
     const char *sample = "strap allows strap developers to replace strap tokens";
 
-    struct timeval start, end;
-    gettimeofday(&start, NULL);
+    strap_timer_scope_t scope;
+    strap_timer_region_begin(&scope, "strreplace");
     for (size_t i = 0; i < iterations; ++i)
     {
         char *replaced = strreplace(sample, "strap", "STRAP");
@@ -108,12 +106,142 @@ static void bench_strreplace(size_t iterations)
         }
         free(replaced);
     }
-    gettimeofday(&end, NULL);
+    int64_t elapsed_ns = strap_timer_region_end(&scope);
 
-    double secs = elapsed_seconds(start, end);
+    double secs = elapsed_seconds(elapsed_ns);
     printf("strreplace (%zu iterations): %.3f ms\n", iterations, secs * 1000.0);
 }
 
+static void bench_iso8601_parse(size_t iterations)
+{
+    const char *samples[] = {"2024-05-17T12:34:56.123456+02:00", "2023-11-01T00:00:01Z", "2021-07-04 18:00:00,5-05:00"};
+
+    strap_timer_scope_t scope;
+    long long checksum = 0;
+    strap_timer_region_begin(&scope, "strap_time_parse_iso8601");
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        struct timeval parsed;
+        int offset;
+        if (strap_time_parse_iso8601(samples[i % 3], &parsed, &offset) != 0)
+        {
+            fprintf(stderr, "strap_time_parse_iso8601 failed: %s\n", strap_error_string(strap_last_error()));
+            exit(EXIT_FAILURE);
+        }
+        checksum += (long long)parsed.tv_sec + offset;
+    }
+    int64_t elapsed_ns = strap_timer_region_end(&scope);
+
+    double secs = elapsed_seconds(elapsed_ns);
+    printf("strap_time_parse_iso8601 (%zu iterations): %.3f ms (checksum %lld)\n", iterations, secs * 1000.0, checksum);
+
+    const char **column = malloc(iterations * sizeof(*column));
+    int64_t *micros = malloc(iterations * sizeof(*micros));
+    int16_t *offsets = malloc(iterations * sizeof(*offsets));
+    if (!column || !micros || !offsets)
+    {
+        fprintf(stderr, "allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < iterations; ++i)
+        column[i] = samples[i % 3];
+
+    checksum = 0;
+    strap_timer_region_begin(&scope, "strap_time_parse_iso8601_batch");
+    if (strap_time_parse_iso8601_batch(column, iterations, micros, offsets, NULL) != 0)
+    {
+        fprintf(stderr, "strap_time_parse_iso8601_batch failed: %s\n", strap_error_string(strap_last_error()));
+        exit(EXIT_FAILURE);
+    }
+    elapsed_ns = strap_timer_region_end(&scope);
+    for (size_t i = 0; i < iterations; ++i)
+        checksum += micros[i] / 1000000 + offsets[i];
+
+    secs = elapsed_seconds(elapsed_ns);
+    printf("strap_time_parse_iso8601_batch (%zu rows): %.3f ms (checksum %lld)\n", iterations, secs * 1000.0, checksum);
+    free(column);
+    free(micros);
+    free(offsets);
+}
+
+static void bench_iso8601_format(size_t iterations)
+{
+    struct timeval tv = {1715949296, 123456};
+    char buffer[64];
+    long long checksum = 0;
+
+    strap_timer_scope_t scope;
+    strap_timer_region_begin(&scope, "strap_time_write_iso8601");
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        tv.tv_sec += 1;
+        int len = strap_time_write_iso8601(tv, 120, buffer, sizeof(buffer));
+        if (len < 0)
+        {
+            fprintf(stderr, "strap_time_write_iso8601 failed: %s\n", strap_error_string(strap_last_error()));
+            exit(EXIT_FAILURE);
+        }
+        checksum += len + buffer[18];
+    }
+    int64_t elapsed_ns = strap_timer_region_end(&scope);
+
+    double secs = elapsed_seconds(elapsed_ns);
+    printf("strap_time_write_iso8601 (%zu iterations): %.3f ms (checksum %lld)\n", iterations, secs * 1000.0, checksum);
+
+    strap_time_formatter_t formatter;
+    strap_time_formatter_init(&formatter, 120);
+    tv.tv_sec = 1715949296;
+    checksum = 0;
+    strap_timer_region_begin(&scope, "strap_time_formatter_format");
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        tv.tv_usec = (long)(i % 1000000);
+        if ((i & 1023) == 0)
+            tv.tv_sec += 1;
+        int len = strap_time_formatter_format(&formatter, tv, buffer, sizeof(buffer));
+        if (len < 0)
+        {
+            fprintf(stderr, "strap_time_formatter_format failed: %s\n", strap_error_string(strap_last_error()));
+            exit(EXIT_FAILURE);
+        }
+        checksum += len + buffer[18];
+    }
+    elapsed_ns = strap_timer_region_end(&scope);
+
+    secs = elapsed_seconds(elapsed_ns);
+    printf("strap_time_formatter_format (%zu iterations): %.3f ms (checksum %lld)\n", iterations, secs * 1000.0, checksum);
+}
+
+static void bench_time_format_parse(size_t iterations)
+{
+    strap_time_format_t *format = strap_time_format_compile("%d/%b/%Y:%H:%M:%S %z");
+    if (!format)
+    {
+        fprintf(stderr, "strap_time_format_compile failed: %s\n", strap_error_string(strap_last_error()));
+        exit(EXIT_FAILURE);
+    }
+
+    strap_timer_scope_t scope;
+    long long checksum = 0;
+    strap_timer_region_begin(&scope, "strap_time_format_parse");
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        struct timeval parsed;
+        int offset;
+        if (strap_time_format_parse(format, "10/Oct/2000:13:55:36 -0700", &parsed, &offset) < 0)
+        {
+            fprintf(stderr, "strap_time_format_parse failed: %s\n", strap_error_string(strap_last_error()));
+            exit(EXIT_FAILURE);
+        }
+        checksum += (long long)parsed.tv_sec + offset;
+    }
+    int64_t elapsed_ns = strap_timer_region_end(&scope);
+    strap_time_format_free(format);
+
+    double secs = elapsed_seconds(elapsed_ns);
+    printf("strap_time_format_parse (%zu iterations): %.3f ms (checksum %lld)\n", iterations, secs * 1000.0, checksum);
+}
+
 int main(int argc, char **argv)
 {
     size_t iterations = 50000;
@@ -124,10 +252,21 @@ int main(int argc, char **argv)
             iterations = 1;
     }
 
-    printf("STRAP micro-benchmarks (iterations=%zu)\n", iterations);
+    strap_timer_calibrate();
+    printf("STRAP micro-benchmarks (iterations=%zu, %.3f ns/tick)\n", iterations, strap_timer_ns_per_tick());
     bench_strjoin(iterations);
     bench_strtrim(iterations);
     bench_strreplace(iterations);
+    bench_iso8601_parse(iterations);
+    bench_iso8601_format(iterations);
+    bench_time_format_parse(iterations);
+
+    printf("\n");
+    if (argc > 2 && strcmp(argv[2], "--json") == 0)
+        strap_timer_report_json(stdout);
+    else
+        strap_timer_report_text(stdout);
+    strap_timer_reset();
 
     return 0;
 }
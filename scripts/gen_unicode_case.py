@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Generate strap_unicode_case.h from the Unicode Character Database.
+
+Usage: gen_unicode_case.py UCD_DIR [OUTPUT]
+
+UCD_DIR must contain UnicodeData.txt and CaseFolding.txt. The simple (1:1)
+lowercase, uppercase and case-folding mappings are compressed into runs of
+code points that share a stride and a delta, which keeps the tables small
+enough to binary-search from strap.c.
+"""
+
+import os
+import re
+import sys
+
+
+def load_unicode_data(path):
+    upper, lower = {}, {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            fields = line.rstrip("\n").split(";")
+            if len(fields) < 14:
+                continue
+            cp = int(fields[0], 16)
+            if fields[12]:
+                upper[cp] = int(fields[12], 16)
+            if fields[13]:
+                lower[cp] = int(fields[13], 16)
+    return upper, lower
+
+
+def load_case_folding(path):
+    fold, version = {}, "unknown"
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            m = re.match(r"#\s*CaseFolding-([\d.]+)\.txt", line)
+            if m:
+                version = m.group(1)
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            code, status, mapping = [x.strip() for x in line.split(";")[:3]]
+            if status in ("C", "S"):
+                fold[int(code, 16)] = int(mapping, 16)
+    return fold, version
+
+
+def compress(mapping):
+    """Greedily group mappings into (start, count, stride, delta) runs."""
+    runs = []
+    items = sorted((cp, dst - cp) for cp, dst in mapping.items() if cp != dst and cp >= 0x80)
+    i = 0
+    while i < len(items):
+        start, delta = items[i]
+        count, stride = 1, 1
+        if i + 1 < len(items) and items[i + 1][1] == delta and items[i + 1][0] - start in (1, 2):
+            stride = items[i + 1][0] - start
+            while (i + count < len(items) and items[i + count][1] == delta and
+                   items[i + count][0] == start + count * stride and count < 0xFFFF):
+                count += 1
+        runs.append((start, count, stride, delta))
+        i += count
+    # strap.c binary-searches on `start`, so runs must not interleave.
+    for a, b in zip(runs, runs[1:]):
+        if a[0] + (a[1] - 1) * a[2] >= b[0]:
+            sys.exit("overlapping runs at U+%04X and U+%04X" % (a[0], b[0]))
+    return runs
+
+
+def check_ascii(name, mapping, expected):
+    for cp in range(0x80):
+        if mapping.get(cp, cp) != expected(cp):
+            sys.exit("%s maps ASCII U+%04X unexpectedly" % (name, cp))
+
+
+def emit(out, name, runs):
+    out.write("static const strap_case_range_t %s[] = {\n" % name)
+    for start, count, stride, delta in runs:
+        out.write("    {0x%05X, %d, %d, %d},\n" % (start, count, stride, delta))
+    out.write("};\n\n")
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    ucd = sys.argv[1]
+    upper, lower = load_unicode_data(os.path.join(ucd, "UnicodeData.txt"))
+    fold, version = load_case_folding(os.path.join(ucd, "CaseFolding.txt"))
+
+    is_upper = lambda cp: 0x41 <= cp <= 0x5A
+    is_lower = lambda cp: 0x61 <= cp <= 0x7A
+    check_ascii("lowercase", lower, lambda cp: cp + 32 if is_upper(cp) else cp)
+    check_ascii("uppercase", upper, lambda cp: cp - 32 if is_lower(cp) else cp)
+    check_ascii("casefold", fold, lambda cp: cp + 32 if is_upper(cp) else cp)
+
+    out = open(sys.argv[2], "w", encoding="utf-8") if len(sys.argv) > 2 else sys.stdout
+    out.write("/* strap_unicode_case.h - generated by scripts/gen_unicode_case.py from\n")
+    out.write(" * Unicode %s UnicodeData.txt and CaseFolding.txt. Do not edit. */\n" % version)
+    out.write("#ifndef STRAP_UNICODE_CASE_H\n#define STRAP_UNICODE_CASE_H\n\n")
+    out.write("/* Simple (1:1) mappings for code points >= U+0080; ASCII is handled inline.\n")
+    out.write(" * Each run maps start + k * stride to start + k * stride + delta for k < count. */\n")
+    out.write("typedef struct\n{\n    uint32_t start;\n    uint16_t count;\n    uint8_t stride;\n    int32_t delta;\n} strap_case_range_t;\n\n")
+    emit(out, "strap_case_lower_ranges", compress(lower))
+    emit(out, "strap_case_upper_ranges", compress(upper))
+    emit(out, "strap_case_fold_ranges", compress(fold))
+    out.write("#endif /* STRAP_UNICODE_CASE_H */\n")
+
+
+if __name__ == "__main__":
+    main()
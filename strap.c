@@ -1,4 +1,9 @@
 #include "strap.h"
+#if defined(STRAP_UNICODE_CASE_HEADER)
+#    include STRAP_UNICODE_CASE_HEADER
+#else
+#    include "strap_unicode_case.h"
+#endif
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
@@ -31,12 +36,166 @@
 #    include <xlocale.h>
 #endif
 
+#if defined(_WIN32)
+#    define STRAP_HAVE_VM 1
+#elif defined(__unix__) || defined(__APPLE__)
+#    include <sys/mman.h>
+#    include <unistd.h>
+#    define STRAP_HAVE_VM 1
+#else
+#    define STRAP_HAVE_VM 0
+#endif
+
 #if defined(_MSC_VER)
 #    define STRAP_THREAD_LOCAL __declspec(thread)
 #else
 #    define STRAP_THREAD_LOCAL _Thread_local
 #endif
 
+/* Word-at-a-time scans of NUL-terminated strings may read past the
+ * terminator, though never into the next page. */
+#define STRAP_MIN_PAGE_SIZE 4096
+#if defined(__GNUC__) || defined(__clang__)
+#    define STRAP_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#    define STRAP_NO_SANITIZE_ADDRESS
+#endif
+
+#if defined(_WIN32)
+typedef SRWLOCK strap_mutex_t;
+#    define STRAP_MUTEX_INIT SRWLOCK_INIT
+#    define strap_mutex_init(m) InitializeSRWLock(m)
+#    define strap_mutex_destroy(m) ((void)(m))
+#    define strap_mutex_lock(m) AcquireSRWLockExclusive(m)
+#    define strap_mutex_unlock(m) ReleaseSRWLockExclusive(m)
+#else
+#    include <pthread.h>
+typedef pthread_mutex_t strap_mutex_t;
+#    define STRAP_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#    define strap_mutex_init(m) pthread_mutex_init((m), NULL)
+#    define strap_mutex_destroy(m) pthread_mutex_destroy(m)
+#    define strap_mutex_lock(m) pthread_mutex_lock(m)
+#    define strap_mutex_unlock(m) pthread_mutex_unlock(m)
+#endif
+
+/* Per-thread allocator caches and timer tables are released when their
+ * thread exits. A thread arms the hook the first time it caches something;
+ * the thread that calls exit() is flushed from an atexit handler since
+ * thread-exit destructors do not run for it. */
+static void strap_thread_exit_flush(void);
+static STRAP_THREAD_LOCAL bool strap_thread_exit_armed = false;
+
+#if defined(_WIN32)
+static DWORD strap_thread_exit_slot = FLS_OUT_OF_INDEXES;
+static INIT_ONCE strap_thread_exit_once = INIT_ONCE_STATIC_INIT;
+
+static VOID NTAPI strap_thread_exit_callback(PVOID value)
+{
+    if (value)
+        strap_thread_exit_flush();
+}
+
+static BOOL CALLBACK strap_thread_exit_init(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    (void)once;
+    (void)param;
+    (void)context;
+    strap_thread_exit_slot = FlsAlloc(strap_thread_exit_callback);
+    atexit(strap_thread_exit_flush);
+    return TRUE;
+}
+
+static void strap_thread_exit_arm(void)
+{
+    if (strap_thread_exit_armed)
+        return;
+    InitOnceExecuteOnce(&strap_thread_exit_once, strap_thread_exit_init, NULL, NULL);
+    if (strap_thread_exit_slot != FLS_OUT_OF_INDEXES)
+        FlsSetValue(strap_thread_exit_slot, (PVOID)1);
+    strap_thread_exit_armed = true;
+}
+#else
+static pthread_key_t strap_thread_exit_key;
+static pthread_once_t strap_thread_exit_once = PTHREAD_ONCE_INIT;
+static bool strap_thread_exit_ready = false;
+
+static void strap_thread_exit_callback(void *value)
+{
+    (void)value;
+    strap_thread_exit_flush();
+}
+
+static void strap_thread_exit_init(void)
+{
+    strap_thread_exit_ready = pthread_key_create(&strap_thread_exit_key, strap_thread_exit_callback) == 0;
+    atexit(strap_thread_exit_flush);
+}
+
+static void strap_thread_exit_arm(void)
+{
+    if (strap_thread_exit_armed)
+        return;
+    pthread_once(&strap_thread_exit_once, strap_thread_exit_init);
+    if (strap_thread_exit_ready)
+        pthread_setspecific(strap_thread_exit_key, (void *)1);
+    strap_thread_exit_armed = true;
+}
+#endif
+
+static size_t strap_atomic_load_size(const volatile size_t *ptr)
+{
+#if defined(_MSC_VER)
+    size_t value = *ptr;
+    MemoryBarrier();
+    return value;
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void strap_atomic_store_size(volatile size_t *ptr, size_t value)
+{
+#if defined(_MSC_VER)
+    MemoryBarrier();
+    *ptr = value;
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+/* Returns the previous value. */
+static size_t strap_atomic_fetch_add_size(volatile size_t *ptr, size_t value)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    return (size_t)InterlockedExchangeAdd64((volatile LONG64 *)ptr, (LONG64)value);
+#elif defined(_MSC_VER)
+    return (size_t)InterlockedExchangeAdd((volatile LONG *)ptr, (LONG)value);
+#else
+    return __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED);
+#endif
+}
+
+static void *strap_atomic_load_ptr(void *const volatile *ptr)
+{
+#if defined(_MSC_VER)
+    void *value = *ptr;
+    MemoryBarrier();
+    return value;
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void strap_atomic_store_ptr(void *volatile *ptr, void *value)
+{
+#if defined(_MSC_VER)
+    MemoryBarrier();
+    *ptr = value;
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
 static STRAP_THREAD_LOCAL strap_error_t strap_global_error = STRAP_OK;
 
 static void strap_set_error(strap_error_t err)
@@ -78,6 +237,76 @@ static int strap_check_add_overflow(size_t a, size_t b)
     return b > 0 && a > SIZE_MAX - b;
 }
 
+/* Allocator hooks */
+static void *strap_default_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *strap_default_realloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void strap_default_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+static strap_allocator_t strap_allocator = {strap_default_malloc, strap_default_realloc, strap_default_free, NULL};
+
+int strap_set_allocator(const strap_allocator_t *allocator)
+{
+    if (!allocator)
+    {
+        strap_allocator.malloc_fn = strap_default_malloc;
+        strap_allocator.realloc_fn = strap_default_realloc;
+        strap_allocator.free_fn = strap_default_free;
+        strap_allocator.ctx = NULL;
+        strap_clear_error();
+        return 0;
+    }
+
+    if (!allocator->malloc_fn || !allocator->realloc_fn || !allocator->free_fn)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    strap_allocator = *allocator;
+    strap_clear_error();
+    return 0;
+}
+
+void strap_free(void *ptr)
+{
+    if (ptr)
+        strap_allocator.free_fn(ptr, strap_allocator.ctx);
+}
+
+static void *strap_mem_alloc(size_t size)
+{
+    return strap_allocator.malloc_fn(size, strap_allocator.ctx);
+}
+
+static void *strap_mem_realloc(void *ptr, size_t size)
+{
+    return strap_allocator.realloc_fn(ptr, size, strap_allocator.ctx);
+}
+
+static char *strap_mem_strdup(const char *s)
+{
+    size_t len = strlen(s);
+    char *copy = strap_mem_alloc(len + 1);
+    if (copy)
+        memcpy(copy, s, len + 1);
+    return copy;
+}
+
 static int strap_check_mul_overflow(size_t a, size_t b)
 {
     return (a != 0 && b > SIZE_MAX / a);
@@ -92,13 +321,45 @@ static unsigned char strap_ascii_tolower(unsigned char ch)
     return ch;
 }
 
-static void strap_split_free_partial(char **tokens, size_t count)
+static unsigned char strap_ascii_toupper(unsigned char ch)
+{
+    if (ch >= 'a' && ch <= 'z')
+        return (unsigned char)(ch - ('a' - 'A'));
+    return ch;
+}
+
+static void strap_split_free_token(strap_slab_t *slab, char *token)
+{
+    if (slab)
+        strap_slab_free(slab, token);
+    else
+        strap_free(token);
+}
+
+static void strap_split_free_partial(strap_slab_t *slab, char **tokens, size_t count)
 {
     if (!tokens)
         return;
     for (size_t i = 0; i < count; ++i)
-        free(tokens[i]);
-    free(tokens);
+        strap_split_free_token(slab, tokens[i]);
+    strap_free(tokens);
+}
+
+/* Copies `len` bytes into a new token taken from `slab`, or the heap. */
+static char *strap_split_token(strap_slab_t *slab, const char *src, size_t len)
+{
+    char *token = slab ? strap_slab_alloc(slab, len + 1) : strap_mem_alloc(len + 1);
+    if (!token)
+    {
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
+    }
+
+    if (len > 0)
+        memcpy(token, src, len);
+    token[len] = '\0';
+    return token;
 }
 
 static int strap_split_reserve(char ***tokens_ptr, size_t *capacity, size_t needed, size_t max_tokens)
@@ -141,7 +402,7 @@ static int strap_split_reserve(char ***tokens_ptr, size_t *capacity, size_t need
         return -1;
     }
 
-    char **resized = realloc(*tokens_ptr, (new_capacity + 1) * sizeof(char *));
+    char **resized = strap_mem_realloc(*tokens_ptr, (new_capacity + 1) * sizeof(char *));
     if (!resized)
     {
         errno = ENOMEM;
@@ -177,6 +438,15 @@ static unsigned strap_highest_bit_index16(unsigned mask)
 #    endif
 }
 
+/* Toggles bit 0x20 on the 26 letters starting at `first` ('A' or 'a'). */
+static __m128i strap_ascii_flip_case16(__m128i chunk, char first)
+{
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - first));
+    const __m128i limit = _mm_set1_epi8((char)(0x80 + 26));
+    __m128i in_range = _mm_cmplt_epi8(_mm_add_epi8(chunk, bias), limit);
+    return _mm_xor_si128(chunk, _mm_and_si128(in_range, _mm_set1_epi8(0x20)));
+}
+
 static size_t strap_trim_leading_ascii_simd(const unsigned char *s, size_t len)
 {
     const __m128i zero = _mm_setzero_si128();
@@ -309,7 +579,7 @@ static int strap_line_buffer_reserve(strap_line_buffer_t *buffer, size_t needed)
         new_capacity *= 2;
     }
 
-    char *resized = realloc(buffer->data, new_capacity);
+    char *resized = strap_mem_realloc(buffer->data, new_capacity);
     if (!resized)
     {
         errno = ENOMEM;
@@ -333,12 +603,135 @@ struct strap_arena_block
     unsigned char data[];
 };
 
+/* Blocks are kept in allocation order. `current` is the bump target; every
+ * block after it is empty, so clearing only has to rewind the cursor.
+ * Requests larger than the next block size get a dedicated side block on
+ * the `oversized` list and never displace the bump block. */
 struct strap_arena
 {
     struct strap_arena_block *head;
+    struct strap_arena_block *current;
+    struct strap_arena_block *oversized;
+    size_t block_size;
+    size_t max_block_size;
+    unsigned growth_factor;
+    size_t alignment;
+    size_t reserved;
+    /* Bumped whenever blocks a mark may point at are freed. */
+    size_t generation;
+    /* Instrumentation; see strap_arena_stats(). */
+    size_t live_bytes;
+    size_t high_water_mark;
+    size_t alignment_padding;
+    size_t oversized_allocs;
+    strap_arena_block_fn on_block;
+    void *on_block_userdata;
+    struct strap_arena *pool_next;
+    /* Reserved virtual range backing the head block, if any. Its capacity is
+     * the committed part; the slow path commits more in `vm_step` units. */
+    struct strap_arena_block *vm_block;
+    size_t vm_reserved;
+    size_t vm_step;
+    bool vm_decommit;
+};
+
+/* Threads bump `current->used` with a fetch-add and only take the lock to
+ * install a new block. A losing fetch-add can push `used` past `capacity`;
+ * such blocks are simply treated as full. `blocks` and `spare` hold regular
+ * blocks, `oversized` holds dedicated blocks for requests larger than
+ * `block_size`. All lists are guarded by `lock`. */
+struct strap_concurrent_arena
+{
+    void *volatile current;
+    struct strap_arena_block *blocks;
+    struct strap_arena_block *spare;
+    struct strap_arena_block *oversized;
     size_t block_size;
+    strap_mutex_t lock;
+};
+
+/* Released arenas go to the releasing thread's one-slot cache first and to
+ * the shared `free_list` otherwise; both count against `max_retained`.
+ * Thread caches are tagged with the pool id rather than its address so a
+ * slot left behind by a destroyed pool is never handed out. An evicted slot
+ * finds its pool through `strap_arena_pool_live` and is destroyed when the
+ * pool is gone. */
+struct strap_arena_pool
+{
+    strap_arena_options_t options;
+    size_t id;
+    struct strap_arena_pool *live_next;
+    size_t max_retained;
+    size_t retained;
+    struct strap_arena *free_list;
+    strap_mutex_t lock;
+};
+
+static volatile size_t strap_arena_pool_next_id = 1;
+static strap_mutex_t strap_arena_pool_live_lock = STRAP_MUTEX_INIT;
+static struct strap_arena_pool *strap_arena_pool_live = NULL;
+static STRAP_THREAD_LOCAL size_t strap_arena_pool_cache_id = 0;
+static STRAP_THREAD_LOCAL struct strap_arena *strap_arena_pool_cache = NULL;
+
+/* Small objects are carved from fixed-size chunks, one size class per
+ * chunk. Freed objects are threaded through their first word. Each thread
+ * keeps per-class free lists for a few slabs at a time and trades batches
+ * with the shared lists under `lock`. `strap_slab_free` finds an object's class
+ * through `registry`, a sorted array of chunk bases that is replaced, never
+ * modified, when a chunk is added. Readers therefore need no lock; replaced
+ * arrays stay on `retired` until the slab is destroyed. */
+#define STRAP_SLAB_CLASS_COUNT 5
+#define STRAP_SLAB_MIN_SIZE 16
+#define STRAP_SLAB_MAX_SIZE 256
+#define STRAP_SLAB_CHUNK_SIZE ((size_t)64 * 1024)
+#define STRAP_SLAB_BATCH 32
+#define STRAP_SLAB_CACHE_LIMIT 128
+#define STRAP_SLAB_THREAD_SLABS 4
+
+struct strap_slab_chunk_ref
+{
+    uintptr_t base;
+    unsigned size_class;
+};
+
+struct strap_slab_registry
+{
+    struct strap_slab_registry *retired_next;
+    size_t count;
+    struct strap_slab_chunk_ref chunks[];
 };
 
+struct strap_slab
+{
+    size_t id;
+    struct strap_slab *live_next;
+    void *volatile registry;
+    struct strap_slab_registry *retired;
+    struct
+    {
+        void *free_list;
+        unsigned char *bump;
+        size_t remaining;
+    } classes[STRAP_SLAB_CLASS_COUNT];
+    strap_mutex_t lock;
+};
+
+typedef struct
+{
+    size_t slab_id;
+    void *heads[STRAP_SLAB_CLASS_COUNT];
+    size_t counts[STRAP_SLAB_CLASS_COUNT];
+} strap_slab_cache_t;
+
+/* Thread caches name their slab by id. A cache evicted from its slot finds
+ * the slab through `strap_slab_live`; once the slab is destroyed its
+ * objects went with its chunks and the cache is simply dropped. */
+static volatile size_t strap_slab_next_id = 1;
+static strap_mutex_t strap_slab_live_lock = STRAP_MUTEX_INIT;
+static struct strap_slab *strap_slab_live = NULL;
+static STRAP_THREAD_LOCAL strap_slab_cache_t strap_slab_caches[STRAP_SLAB_THREAD_SLABS];
+static STRAP_THREAD_LOCAL unsigned strap_slab_cache_victim = 0;
+
 static size_t strap_align_size(size_t value)
 {
     const size_t alignment = sizeof(void *);
@@ -350,6 +743,102 @@ static size_t strap_align_size(size_t value)
     return value + (alignment - remainder);
 }
 
+static bool strap_is_power_of_two(size_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+/* Block data sits right after the header, so its address is only as
+ * aligned as malloc's result plus the header size; padding is computed
+ * from the actual address rather than the offset. */
+static size_t strap_align_padding(const void *address, size_t alignment)
+{
+    return (size_t)(-(uintptr_t)address) & (alignment - 1);
+}
+
+/* Virtual memory */
+#if STRAP_HAVE_VM
+#    define STRAP_VM_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+#    define STRAP_VM_MIN_STEP ((size_t)64 * 1024)
+
+static size_t strap_vm_page_size(void)
+{
+#    if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+#    else
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096;
+#    endif
+}
+
+/* Reserves address space without backing memory. With `huge` the range is
+ * aligned to the huge page size and flagged for transparent huge pages. */
+static void *strap_vm_reserve(size_t size, bool huge)
+{
+#    if defined(_WIN32)
+    (void)huge;
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#    else
+    int flags = MAP_PRIVATE | MAP_ANON;
+#        if defined(MAP_NORESERVE)
+    flags |= MAP_NORESERVE;
+#        endif
+    size_t slack = huge ? STRAP_VM_HUGE_PAGE_SIZE : 0;
+    unsigned char *raw = mmap(NULL, size + slack, PROT_NONE, flags, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+
+    unsigned char *base = raw;
+    if (slack)
+    {
+        base = raw + strap_align_padding(raw, STRAP_VM_HUGE_PAGE_SIZE);
+        if (base > raw)
+            munmap(raw, (size_t)(base - raw));
+        if (raw + slack > base)
+            munmap(base + size, (size_t)(raw + slack - base));
+#        if defined(MADV_HUGEPAGE)
+        madvise(base, size, MADV_HUGEPAGE);
+#        endif
+    }
+    return base;
+#    endif
+}
+
+static bool strap_vm_commit(void *address, size_t size)
+{
+#    if defined(_WIN32)
+    return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#    else
+    return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+#    endif
+}
+
+/* Returns the pages to the system and makes the range inaccessible again. */
+static void strap_vm_decommit(void *address, size_t size)
+{
+#    if defined(_WIN32)
+    VirtualFree(address, size, MEM_DECOMMIT);
+#    else
+#        if defined(MADV_DONTNEED)
+    madvise(address, size, MADV_DONTNEED);
+#        endif
+    mprotect(address, size, PROT_NONE);
+#    endif
+}
+
+static void strap_vm_release(void *address, size_t size)
+{
+#    if defined(_WIN32)
+    (void)size;
+    VirtualFree(address, 0, MEM_RELEASE);
+#    else
+    munmap(address, size);
+#    endif
+}
+#endif
+
 static struct strap_arena_block *strap_arena_new_block(size_t capacity)
 {
     if (capacity == 0)
@@ -364,7 +853,7 @@ static struct strap_arena_block *strap_arena_new_block(size_t capacity)
     }
 
     size_t total = header_size + capacity;
-    struct strap_arena_block *block = malloc(total);
+    struct strap_arena_block *block = strap_mem_alloc(total);
     if (!block)
     {
         errno = ENOMEM;
@@ -381,6 +870,8 @@ static struct strap_arena_block *strap_arena_new_block(size_t capacity)
 /* --------------------------------------------------------------------- */
 /* Locale helpers                                                        */
 
+#define STRAP_LOCALE_CACHE_SIZE 16
+
 typedef enum
 {
     STRAP_LOCALE_NONE,
@@ -388,6 +879,24 @@ typedef enum
     STRAP_LOCALE_GLOBAL
 } strap_locale_kind_t;
 
+struct strap_locale
+{
+    strap_locale_kind_t kind;
+#if defined(_WIN32)
+    _locale_t handle;
+#else
+    locale_t handle;
+#endif
+    char *name;
+    /* Byte case maps captured when the locale is opened. `ascii_lower` and
+     * `ascii_upper` record whether the 7-bit half is plain ASCII folding,
+     * which lets pure-ASCII runs skip the table. */
+    unsigned char lower[256];
+    unsigned char upper[256];
+    bool ascii_lower;
+    bool ascii_upper;
+};
+
 typedef struct
 {
     strap_locale_kind_t kind;
@@ -399,127 +908,285 @@ typedef struct
     char *saved_global;
 } strap_locale_ctx;
 
-static int strap_locale_enter(const char *locale_name, strap_locale_ctx *ctx)
+/* Process-wide locale used when no name is given. */
+static strap_locale_t strap_locale_process = {STRAP_LOCALE_NONE};
+
+/* Named locales are created once and kept for the lifetime of the process.
+ * Readers scan the published prefix of the table without locking; inserts
+ * are serialised by strap_locale_cache_lock. */
+static strap_locale_t *strap_locale_cache[STRAP_LOCALE_CACHE_SIZE];
+static size_t strap_locale_cache_count = 0;
+static strap_mutex_t strap_locale_cache_lock = STRAP_MUTEX_INIT;
+
+static int strap_locale_map_char(const strap_locale_t *locale, int ch, int make_upper)
 {
-    ctx->kind = STRAP_LOCALE_NONE;
-    ctx->saved_global = NULL;
+#if defined(_WIN32)
+    if (locale->kind == STRAP_LOCALE_HANDLE)
+        return make_upper ? _toupper_l(ch, locale->handle) : _tolower_l(ch, locale->handle);
+#elif defined(LC_ALL_MASK)
+    if (locale->kind == STRAP_LOCALE_HANDLE)
+        return make_upper ? toupper_l(ch, locale->handle) : tolower_l(ch, locale->handle);
+#endif
+    return make_upper ? toupper(ch) : tolower(ch);
+}
+
+/* For STRAP_LOCALE_GLOBAL this must run while the locale is active. */
+static void strap_locale_build_tables(strap_locale_t *locale)
+{
+    locale->ascii_lower = true;
+    locale->ascii_upper = true;
+
+    for (int ch = 0; ch < 256; ++ch)
+    {
+        unsigned char lower = (unsigned char)strap_locale_map_char(locale, ch, 0);
+        unsigned char upper = (unsigned char)strap_locale_map_char(locale, ch, 1);
+        locale->lower[ch] = lower;
+        locale->upper[ch] = upper;
+
+        if (ch < 0x80)
+        {
+            if (lower != strap_ascii_tolower((unsigned char)ch))
+                locale->ascii_lower = false;
+            if (upper != strap_ascii_toupper((unsigned char)ch))
+                locale->ascii_upper = false;
+        }
+    }
+}
+
+static int strap_locale_init(strap_locale_t *locale, const char *locale_name)
+{
+    locale->kind = STRAP_LOCALE_NONE;
+    locale->name = NULL;
 
     if (!locale_name || locale_name[0] == '\0')
         return 0;
 
+    locale->name = strap_mem_strdup(locale_name);
+    if (!locale->name)
+    {
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return -1;
+    }
+
 #if defined(_WIN32)
-    ctx->handle = _create_locale(LC_ALL, locale_name);
-    if (!ctx->handle)
+    locale->handle = _create_locale(LC_ALL, locale_name);
+    if (!locale->handle)
     {
+        strap_free(locale->name);
+        locale->name = NULL;
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
-    ctx->kind = STRAP_LOCALE_HANDLE;
+    locale->kind = STRAP_LOCALE_HANDLE;
+    strap_locale_build_tables(locale);
     return 0;
 #elif defined(LC_ALL_MASK)
-    ctx->handle = newlocale(LC_ALL_MASK, locale_name, (locale_t)0);
-    if (!ctx->handle)
+    locale->handle = newlocale(LC_ALL_MASK, locale_name, (locale_t)0);
+    if (!locale->handle)
     {
+        strap_free(locale->name);
+        locale->name = NULL;
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
-    ctx->kind = STRAP_LOCALE_HANDLE;
+    locale->kind = STRAP_LOCALE_HANDLE;
+    strap_locale_build_tables(locale);
     return 0;
 #else
+    /* No per-thread locale objects: validate the name and capture the case
+     * tables now, and switch the global locale around collation. */
     const char *current = setlocale(LC_ALL, NULL);
-    if (!current)
-    {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return -1;
-    }
-    ctx->saved_global = strdup(current);
-    if (!ctx->saved_global)
+    char *saved = current ? strap_mem_strdup(current) : NULL;
+    if (!saved)
     {
-        errno = ENOMEM;
-        strap_set_error(STRAP_ERR_ALLOC);
+        strap_free(locale->name);
+        locale->name = NULL;
+        errno = current ? ENOMEM : EINVAL;
+        strap_set_error(current ? STRAP_ERR_ALLOC : STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
-    if (!setlocale(LC_ALL, locale_name))
-    {
-        free(ctx->saved_global);
-        ctx->saved_global = NULL;
+    locale->kind = STRAP_LOCALE_GLOBAL;
+    int valid = setlocale(LC_ALL, locale_name) != NULL;
+    if (valid)
+        strap_locale_build_tables(locale);
+    setlocale(LC_ALL, saved);
+    strap_free(saved);
+    if (!valid)
+    {
+        strap_free(locale->name);
+        locale->name = NULL;
+        locale->kind = STRAP_LOCALE_NONE;
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
-    ctx->kind = STRAP_LOCALE_GLOBAL;
     return 0;
 #endif
 }
 
-static void strap_locale_exit(strap_locale_ctx *ctx)
+static void strap_locale_release(strap_locale_t *locale)
 {
-    if (!ctx)
-        return;
-
-    switch (ctx->kind)
+    if (locale->kind == STRAP_LOCALE_HANDLE)
     {
-    case STRAP_LOCALE_NONE:
-        break;
-    case STRAP_LOCALE_HANDLE:
 #if defined(_WIN32)
-        if (ctx->handle)
-            _free_locale(ctx->handle);
+        _free_locale(locale->handle);
 #else
-        if (ctx->handle)
-            freelocale(ctx->handle);
+        freelocale(locale->handle);
 #endif
-        break;
-    case STRAP_LOCALE_GLOBAL:
-        if (ctx->saved_global)
-            setlocale(LC_ALL, ctx->saved_global);
-        free(ctx->saved_global);
-        ctx->saved_global = NULL;
-        break;
     }
-
-    ctx->kind = STRAP_LOCALE_NONE;
+    strap_free(locale->name);
+    locale->name = NULL;
+    locale->kind = STRAP_LOCALE_NONE;
 }
 
-static int strap_tolower_locale_ctx(int ch, const strap_locale_ctx *ctx)
+static const strap_locale_t *strap_locale_cache_find(const char *locale_name, size_t count)
 {
-    unsigned char c = (unsigned char)ch;
-    switch (ctx->kind)
+    for (size_t i = 0; i < count; ++i)
     {
-    case STRAP_LOCALE_HANDLE:
-#if defined(_WIN32)
-        return _tolower_l(c, ctx->handle);
-#else
-        return tolower_l(c, ctx->handle);
-#endif
-    case STRAP_LOCALE_GLOBAL:
-    case STRAP_LOCALE_NONE:
-    default:
-        return tolower(c);
+        if (strcmp(strap_locale_cache[i]->name, locale_name) == 0)
+            return strap_locale_cache[i];
     }
+    return NULL;
 }
 
-static int strap_toupper_locale_ctx(int ch, const strap_locale_ctx *ctx)
+/* Resolves a locale name to a shared handle. When the cache is full the
+ * locale is built into `scratch` and must be handed to
+ * strap_locale_lookup_done() afterwards. */
+static const strap_locale_t *strap_locale_lookup(const char *locale_name, strap_locale_t *scratch)
 {
-    unsigned char c = (unsigned char)ch;
-    switch (ctx->kind)
+    if (!locale_name || locale_name[0] == '\0')
+        return &strap_locale_process;
+
+    const strap_locale_t *found =
+        strap_locale_cache_find(locale_name, strap_atomic_load_size(&strap_locale_cache_count));
+    if (found)
+        return found;
+
+    strap_mutex_lock(&strap_locale_cache_lock);
+    size_t count = strap_locale_cache_count;
+    found = strap_locale_cache_find(locale_name, count);
+    if (!found && count < STRAP_LOCALE_CACHE_SIZE)
     {
+        strap_locale_t *created = strap_locale_open(locale_name);
+        if (created)
+        {
+            strap_locale_cache[count] = created;
+            strap_atomic_store_size(&strap_locale_cache_count, count + 1);
+        }
+        strap_mutex_unlock(&strap_locale_cache_lock);
+        return created;
+    }
+    strap_mutex_unlock(&strap_locale_cache_lock);
+
+    if (found)
+        return found;
+    if (strap_locale_init(scratch, locale_name) != 0)
+        return NULL;
+    return scratch;
+}
+
+static void strap_locale_lookup_done(const strap_locale_t *locale, strap_locale_t *scratch)
+{
+    if (locale == scratch)
+        strap_locale_release(scratch);
+}
+
+static int strap_locale_enter(const strap_locale_t *locale, strap_locale_ctx *ctx)
+{
+    ctx->kind = locale->kind;
+    ctx->saved_global = NULL;
+
+    switch (locale->kind)
+    {
+    case STRAP_LOCALE_NONE:
+        return 0;
     case STRAP_LOCALE_HANDLE:
-#if defined(_WIN32)
-        return _toupper_l(c, ctx->handle);
-#else
-        return toupper_l(c, ctx->handle);
-#endif
+        ctx->handle = locale->handle;
+        return 0;
     case STRAP_LOCALE_GLOBAL:
-    case STRAP_LOCALE_NONE:
     default:
-        return toupper(c);
+        break;
+    }
+
+    const char *current = setlocale(LC_ALL, NULL);
+    if (!current)
+    {
+        ctx->kind = STRAP_LOCALE_NONE;
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+    ctx->saved_global = strap_mem_strdup(current);
+    if (!ctx->saved_global)
+    {
+        ctx->kind = STRAP_LOCALE_NONE;
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return -1;
+    }
+    if (!setlocale(LC_ALL, locale->name))
+    {
+        strap_free(ctx->saved_global);
+        ctx->saved_global = NULL;
+        ctx->kind = STRAP_LOCALE_NONE;
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+    return 0;
+}
+
+static void strap_locale_exit(strap_locale_ctx *ctx)
+{
+    if (!ctx)
+        return;
+
+    if (ctx->kind == STRAP_LOCALE_GLOBAL)
+    {
+        if (ctx->saved_global)
+            setlocale(LC_ALL, ctx->saved_global);
+        strap_free(ctx->saved_global);
+        ctx->saved_global = NULL;
     }
+
+    ctx->kind = STRAP_LOCALE_NONE;
 }
 
+/* Applies a 256-entry case map. When the 7-bit half of the map is plain
+ * ASCII folding, 16-byte runs without high-bit bytes are converted with a
+ * range compare instead of per-byte lookups. */
+static void strap_case_map_bytes(unsigned char *dst, const unsigned char *src, size_t len,
+                                 const unsigned char *map, bool ascii_map, int make_upper)
+{
+    size_t i = 0;
+
+#if STRAP_HAVE_SSE2
+    if (ascii_map)
+    {
+        const char first = make_upper ? 'a' : 'A';
+        for (; i + 16 <= len; i += 16)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(src + i));
+            if (_mm_movemask_epi8(chunk) != 0)
+            {
+                for (size_t j = 0; j < 16; ++j)
+                    dst[i + j] = map[src[i + j]];
+                continue;
+            }
+            _mm_storeu_si128((__m128i *)(dst + i), strap_ascii_flip_case16(chunk, first));
+        }
+    }
+#else
+    (void)ascii_map;
+    (void)make_upper;
+#endif
+
+    for (; i < len; ++i)
+        dst[i] = map[src[i]];
+}
 
 /* Safe reading */
 void strap_line_buffer_init(strap_line_buffer_t *buffer)
@@ -545,7 +1212,7 @@ void strap_line_buffer_free(strap_line_buffer_t *buffer)
         return;
     }
 
-    free(buffer->data);
+    strap_free(buffer->data);
     buffer->data = NULL;
     buffer->capacity = 0;
 }
@@ -632,7 +1299,7 @@ char *afgets(FILE *f)
         return NULL;
     }
 
-    char *result = strdup(inplace);
+    char *result = strap_mem_strdup(inplace);
     strap_line_buffer_free(&buffer);
 
     if (!result)
@@ -659,7 +1326,7 @@ char *afread(FILE *f, size_t *out_len)
     size_t capacity = chunk;
     size_t len = 0;
 
-    char *buffer = malloc(capacity + 1);
+    char *buffer = strap_mem_alloc(capacity + 1);
     if (!buffer)
     {
         errno = ENOMEM;
@@ -673,16 +1340,16 @@ char *afread(FILE *f, size_t *out_len)
         {
             if (strap_check_add_overflow(capacity, chunk))
             {
-                free(buffer);
+                strap_free(buffer);
                 errno = EOVERFLOW;
                 strap_set_error(STRAP_ERR_OVERFLOW);
                 return NULL;
             }
             size_t new_capacity = capacity + chunk;
-            char *tmp = realloc(buffer, new_capacity + 1);
+            char *tmp = strap_mem_realloc(buffer, new_capacity + 1);
             if (!tmp)
             {
-                free(buffer);
+                strap_free(buffer);
                 errno = ENOMEM;
                 strap_set_error(STRAP_ERR_ALLOC);
                 return NULL;
@@ -702,7 +1369,7 @@ char *afread(FILE *f, size_t *out_len)
 
             if (ferror(f))
             {
-                free(buffer);
+                strap_free(buffer);
                 errno = EIO;
                 strap_set_error(STRAP_ERR_IO);
                 return NULL;
@@ -712,7 +1379,7 @@ char *afread(FILE *f, size_t *out_len)
 
     buffer[len] = '\0';
 
-    char *shrunk = realloc(buffer, len + 1);
+    char *shrunk = strap_mem_realloc(buffer, len + 1);
     if (shrunk)
         buffer = shrunk;
 
@@ -724,9 +1391,130 @@ char *afread(FILE *f, size_t *out_len)
 }
 
 /* Arena allocator */
-strap_arena_t *strap_arena_create(size_t block_size)
+#if STRAP_HAVE_VM
+static bool strap_arena_vm_init(strap_arena_t *arena, size_t reserve, bool huge)
+{
+    size_t page = strap_vm_page_size();
+    size_t step = huge ? STRAP_VM_HUGE_PAGE_SIZE : (page > STRAP_VM_MIN_STEP ? page : STRAP_VM_MIN_STEP);
+    size_t rounded = reserve + (step - 1);
+    if (rounded < reserve || rounded > SIZE_MAX - STRAP_VM_HUGE_PAGE_SIZE)
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return false;
+    }
+    rounded -= rounded % step;
+
+    void *base = strap_vm_reserve(rounded, huge);
+    if (!base || !strap_vm_commit(base, step))
+    {
+        if (base)
+            strap_vm_release(base, rounded);
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return false;
+    }
+
+    struct strap_arena_block *block = base;
+    block->next = NULL;
+    block->capacity = step - sizeof(struct strap_arena_block);
+    block->used = 0;
+
+    arena->head = block;
+    arena->current = block;
+    arena->reserved = block->capacity;
+    arena->vm_block = block;
+    arena->vm_reserved = rounded;
+    arena->vm_step = step;
+    return true;
+}
+#endif
+
+/* Commits enough of the reserved range for `extra` more bytes in `block`.
+ * Returns false when `block` is not the VM block or the range is exhausted. */
+static bool strap_arena_vm_grow(strap_arena_t *arena, struct strap_arena_block *block, size_t extra)
+{
+#if STRAP_HAVE_VM
+    if (!block || block != arena->vm_block)
+        return false;
+
+    size_t header = sizeof(struct strap_arena_block);
+    size_t limit = arena->vm_reserved - header;
+    if (block->used > limit || extra > limit - block->used)
+        return false;
+
+    size_t committed = header + block->capacity;
+    size_t needed = header + block->used + extra;
+    size_t target = needed + (arena->vm_step - 1);
+    target = target > arena->vm_reserved ? arena->vm_reserved : target - target % arena->vm_step;
+    if (!strap_vm_commit((unsigned char *)block + committed, target - committed))
+        return false;
+
+    arena->reserved += target - committed;
+    block->capacity = target - header;
+    return true;
+#else
+    (void)arena;
+    (void)block;
+    (void)extra;
+    return false;
+#endif
+}
+
+/* Decommits the VM block beyond its used part, keeping the first step. */
+static size_t strap_arena_vm_shrink(strap_arena_t *arena)
+{
+#if STRAP_HAVE_VM
+    struct strap_arena_block *block = arena->vm_block;
+    if (!block)
+        return 0;
+
+    size_t header = sizeof(struct strap_arena_block);
+    size_t keep = header + block->used + (arena->vm_step - 1);
+    keep -= keep % arena->vm_step;
+    size_t committed = header + block->capacity;
+    if (keep >= committed)
+        return 0;
+
+    strap_vm_decommit((unsigned char *)block + keep, committed - keep);
+    arena->reserved -= committed - keep;
+    block->capacity = keep - header;
+    return committed - keep;
+#else
+    (void)arena;
+    return 0;
+#endif
+}
+
+void strap_arena_options_init(strap_arena_options_t *options)
+{
+    if (!options)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return;
+    }
+
+    options->block_size = 4096;
+    options->max_block_size = 0;
+    options->growth_factor = 0;
+    options->alignment = 0;
+    options->vm_reserve = 0;
+    options->huge_pages = false;
+    options->decommit_on_clear = false;
+    strap_clear_error();
+}
+
+strap_arena_t *strap_arena_create_ex(const strap_arena_options_t *options)
 {
-    strap_arena_t *arena = malloc(sizeof(*arena));
+    if (!options || (options->alignment != 0 && !strap_is_power_of_two(options->alignment)))
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    strap_arena_t *arena = strap_mem_alloc(sizeof(*arena));
     if (!arena)
     {
         errno = ENOMEM;
@@ -734,29 +1522,85 @@ strap_arena_t *strap_arena_create(size_t block_size)
         return NULL;
     }
 
-    if (block_size == 0)
-        block_size = 4096;
+    size_t block_size = options->block_size ? options->block_size : 4096;
+    size_t max_block_size = options->max_block_size;
+    if (max_block_size < block_size)
+        max_block_size = block_size;
 
     arena->head = NULL;
+    arena->current = NULL;
+    arena->oversized = NULL;
     arena->block_size = block_size;
+    arena->max_block_size = max_block_size;
+    arena->growth_factor = options->growth_factor > 1 ? options->growth_factor : 1;
+    arena->alignment = options->alignment > sizeof(void *) ? options->alignment : sizeof(void *);
+    arena->reserved = 0;
+    arena->generation = 0;
+    arena->live_bytes = 0;
+    arena->high_water_mark = 0;
+    arena->alignment_padding = 0;
+    arena->oversized_allocs = 0;
+    arena->on_block = NULL;
+    arena->on_block_userdata = NULL;
+    arena->pool_next = NULL;
+    arena->vm_block = NULL;
+    arena->vm_reserved = 0;
+    arena->vm_step = 0;
+    arena->vm_decommit = options->decommit_on_clear;
+
+#if STRAP_HAVE_VM
+    if (options->vm_reserve && !strap_arena_vm_init(arena, options->vm_reserve, options->huge_pages))
+    {
+        strap_free(arena);
+        return NULL;
+    }
+#endif
+
     strap_clear_error();
     return arena;
 }
 
-void strap_arena_destroy(strap_arena_t *arena)
+strap_arena_t *strap_arena_create(size_t block_size)
 {
-    if (!arena)
-        return;
+    strap_arena_options_t options;
+    strap_arena_options_init(&options);
+    if (block_size != 0)
+        options.block_size = block_size;
+    return strap_arena_create_ex(&options);
+}
 
-    struct strap_arena_block *block = arena->head;
-    while (block)
+/* Frees blocks up to `stop` and returns the bytes they had in use. */
+static size_t strap_arena_free_list(struct strap_arena_block *block, struct strap_arena_block *stop)
+{
+    size_t used = 0;
+    while (block != stop)
     {
         struct strap_arena_block *next = block->next;
-        free(block);
+        used += block->used;
+        strap_free(block);
         block = next;
     }
+    return used;
+}
+
+void strap_arena_destroy(strap_arena_t *arena)
+{
+    if (!arena)
+        return;
 
-    free(arena);
+    strap_arena_free_list(arena->oversized, NULL);
+#if STRAP_HAVE_VM
+    if (arena->vm_block)
+    {
+        /* The VM block is always the head. */
+        strap_arena_free_list(arena->vm_block->next, NULL);
+        strap_vm_release(arena->vm_block, arena->vm_reserved);
+        strap_free(arena);
+        return;
+    }
+#endif
+    strap_arena_free_list(arena->head, NULL);
+    strap_free(arena);
 }
 
 void strap_arena_clear(strap_arena_t *arena)
@@ -770,1620 +1614,5544 @@ void strap_arena_clear(strap_arena_t *arena)
 
     for (struct strap_arena_block *block = arena->head; block; block = block->next)
         block->used = 0;
+    arena->current = arena->head;
+
+    strap_arena_free_list(arena->oversized, NULL);
+    arena->oversized = NULL;
+    arena->live_bytes = 0;
+    arena->generation++;
+
+    if (arena->vm_decommit)
+        strap_arena_vm_shrink(arena);
 
     strap_clear_error();
 }
 
-void *strap_arena_alloc(strap_arena_t *arena, size_t size)
+size_t strap_arena_trim(strap_arena_t *arena, size_t keep_bytes)
 {
-    if (!arena || size == 0)
+    if (!arena)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        return 0;
     }
 
-    size_t aligned = strap_align_size(size);
-    if (aligned == SIZE_MAX)
-    {
-        errno = EOVERFLOW;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return NULL;
-    }
+    size_t released = 0;
 
-    struct strap_arena_block *block = arena->head;
-    if (!block || block->used + aligned > block->capacity)
+    /* Only blocks past the cursor are guaranteed to be empty. */
+    struct strap_arena_block **link = arena->current ? &arena->current->next : &arena->head;
+    while (*link && arena->reserved > keep_bytes)
     {
-        size_t block_capacity = arena->block_size;
-        if (aligned > block_capacity)
-            block_capacity = aligned;
+        struct strap_arena_block *block = *link;
+        *link = block->next;
+        arena->reserved -= block->capacity;
+        released += block->capacity;
+        strap_free(block);
+    }
 
-        struct strap_arena_block *new_block = strap_arena_new_block(block_capacity);
-        if (!new_block)
-            return NULL;
+    /* A VM block gives back committed pages past its used part. */
+    if (arena->vm_block && arena->current == arena->vm_block && arena->reserved > keep_bytes)
+        released += strap_arena_vm_shrink(arena);
 
-        new_block->next = arena->head;
-        arena->head = new_block;
-        block = new_block;
+    /* A fully cleared arena may give back its first block as well. */
+    if (arena->current && arena->current == arena->head && arena->head != arena->vm_block &&
+        arena->head->used == 0 && !arena->head->next && arena->reserved > keep_bytes)
+    {
+        released += arena->head->capacity;
+        arena->reserved -= arena->head->capacity;
+        strap_free(arena->head);
+        arena->head = NULL;
+        arena->current = NULL;
     }
 
-    void *memory = block->data + block->used;
-    block->used += aligned;
+    if (released > 0)
+        arena->generation++;
     strap_clear_error();
-    return memory;
+    return released;
 }
 
-char *strap_arena_strdup(strap_arena_t *arena, const char *s)
+strap_arena_mark_t strap_arena_mark(const strap_arena_t *arena)
 {
-    if (!arena || !s)
+    strap_arena_mark_t mark;
+    mark.block = NULL;
+    mark.used = 0;
+    mark.oversized = NULL;
+    mark.generation = 0;
+
+    if (!arena)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
-    }
-
-    size_t len = strlen(s);
-    if (strap_check_add_overflow(len, 1))
-    {
-        errno = EOVERFLOW;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return NULL;
+        return mark;
     }
 
-    char *dst = strap_arena_alloc(arena, len + 1);
-    if (!dst)
-        return NULL;
-
-    memcpy(dst, s, len + 1);
+    mark.block = arena->current;
+    mark.used = arena->current ? arena->current->used : 0;
+    mark.oversized = arena->oversized;
+    mark.generation = arena->generation;
     strap_clear_error();
-    return dst;
+    return mark;
 }
 
-char *strap_arena_strndup(strap_arena_t *arena, const char *s, size_t n)
+void strap_arena_rewind(strap_arena_t *arena, strap_arena_mark_t mark)
 {
-    if (!arena || !s)
+    if (!arena || mark.generation != arena->generation)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        return;
     }
 
-    if (strap_check_add_overflow(n, 1))
+    arena->live_bytes -= strap_arena_free_list(arena->oversized, mark.oversized);
+    arena->oversized = mark.oversized;
+
+    struct strap_arena_block *target = mark.block;
+    if (!target)
     {
-        errno = EOVERFLOW;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return NULL;
+        /* No regular block was in use at the mark, so every block's
+         * contents are newer; oversized allocations before it survive. */
+        for (struct strap_arena_block *block = arena->head; block; block = block->next)
+        {
+            arena->live_bytes -= block->used;
+            block->used = 0;
+        }
+        arena->current = arena->head;
+        strap_clear_error();
+        return;
     }
 
-    char *dst = strap_arena_alloc(arena, n + 1);
-    if (!dst)
-        return NULL;
+    /* Everything allocated since the mark lives in `target` past the saved
+     * offset or in the blocks that follow it, up to the cursor. */
+    struct strap_arena_block *stop = arena->current ? arena->current->next : NULL;
+    for (struct strap_arena_block *block = target->next; block != stop; block = block->next)
+    {
+        arena->live_bytes -= block->used;
+        block->used = 0;
+    }
 
-    memcpy(dst, s, n);
-    dst[n] = '\0';
+    arena->live_bytes -= target->used - mark.used;
+    target->used = mark.used;
+    arena->current = target;
     strap_clear_error();
-    return dst;
 }
 
-/* String manipulation */
-static char *strjoin_impl(strap_arena_t *arena, const char **parts, size_t nparts, const char *sep)
+/* Advances the cursor to the next retained block that can hold `size`
+ * bytes, or inserts a fresh block right after the cursor. */
+static struct strap_arena_block *strap_arena_advance(strap_arena_t *arena, size_t size)
 {
-    if (!parts || nparts == 0)
+    struct strap_arena_block *candidate = arena->current ? arena->current->next : arena->head;
+    for (; candidate; candidate = candidate->next)
     {
-        if (arena)
-        {
-            char *empty = strap_arena_alloc(arena, 1);
-            if (!empty)
-                return NULL;
-            empty[0] = '\0';
-            strap_clear_error();
-            return empty;
-        }
-
-        char *empty = strdup("");
-        if (!empty)
-        {
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-        }
-        else
+        if (candidate->capacity >= size)
         {
-            strap_clear_error();
+            arena->current = candidate;
+            return candidate;
         }
-        return empty;
     }
 
-    size_t sep_len = sep ? strlen(sep) : 0;
-    size_t *lengths = malloc(nparts * sizeof(size_t));
-    if (!lengths)
-    {
-        errno = ENOMEM;
-        strap_set_error(STRAP_ERR_ALLOC);
+    struct strap_arena_block *block = strap_arena_new_block(arena->block_size);
+    if (!block)
         return NULL;
-    }
+    if (arena->on_block)
+        arena->on_block(block->capacity, false, arena->on_block_userdata);
 
-    size_t total_len = 1; /* null terminator */
+    /* Geometric growth: each fresh block is larger, up to the cap. */
+    if (arena->growth_factor > 1 && arena->block_size < arena->max_block_size)
+    {
+        size_t next = arena->max_block_size;
+        if (!strap_check_mul_overflow(arena->block_size, arena->growth_factor) &&
+            arena->block_size * arena->growth_factor < next)
+            next = arena->block_size * arena->growth_factor;
+        arena->block_size = next;
+    }
 
-    for (size_t i = 0; i < nparts; ++i)
+    if (arena->current)
     {
-        size_t part_len = parts[i] ? strlen(parts[i]) : 0;
-        lengths[i] = part_len;
+        block->next = arena->current->next;
+        arena->current->next = block;
+    }
+    else
+    {
+        block->next = arena->head;
+        arena->head = block;
+    }
 
-        if (strap_check_add_overflow(total_len, part_len))
-        {
-            free(lengths);
-            errno = EOVERFLOW;
-            strap_set_error(STRAP_ERR_OVERFLOW);
-            return NULL;
-        }
-        total_len += part_len;
+    arena->current = block;
+    arena->reserved += block->capacity;
+    return block;
+}
 
-        if (i + 1 < nparts && sep_len > 0)
-        {
-            if (strap_check_add_overflow(total_len, sep_len))
-            {
-                free(lengths);
-                errno = EOVERFLOW;
-                strap_set_error(STRAP_ERR_OVERFLOW);
-                return NULL;
-            }
-            total_len += sep_len;
-        }
-    }
+/* `size` is already rounded; the side block is over-allocated by
+ * `alignment - 1` so the start can be padded to the requested boundary. */
+static void *strap_arena_alloc_oversized(strap_arena_t *arena, size_t size, size_t worst, size_t alignment)
+{
+    struct strap_arena_block *block = strap_arena_new_block(worst);
+    if (!block)
+        return NULL;
+    if (arena->on_block)
+        arena->on_block(block->capacity, true, arena->on_block_userdata);
+
+    size_t padding = strap_align_padding(block->data, alignment);
+    block->used = padding + size;
+    block->next = arena->oversized;
+    arena->oversized = block;
+
+    arena->oversized_allocs += 1;
+    arena->alignment_padding += padding;
+    arena->live_bytes += block->used;
+    if (arena->live_bytes > arena->high_water_mark)
+        arena->high_water_mark = arena->live_bytes;
+    strap_clear_error();
+    return block->data + padding;
+}
 
-    char *result;
-    if (arena)
-    {
-        result = strap_arena_alloc(arena, total_len);
-        if (!result)
-        {
-            free(lengths);
-            return NULL;
-        }
-    }
-    else
+/* Sizes are always rounded to pointer alignment so the end of the last
+ * allocation is predictable (see strap_arena_realloc); larger alignments
+ * are satisfied by padding the start. */
+static void *strap_arena_alloc_impl(strap_arena_t *arena, size_t size, size_t alignment)
+{
+    size_t aligned = strap_align_size(size);
+    if (aligned == SIZE_MAX || strap_check_add_overflow(aligned, alignment - 1))
     {
-        result = malloc(total_len);
-        if (!result)
-        {
-            free(lengths);
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-            return NULL;
-        }
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
     }
 
-    char *write_ptr = result;
-    for (size_t i = 0; i < nparts; ++i)
+    size_t padding = 0;
+    struct strap_arena_block *block = arena->current;
+    if (block)
+        padding = strap_align_padding(block->data + block->used, alignment);
+    if ((!block || block->used + padding + aligned > block->capacity) &&
+        !strap_arena_vm_grow(arena, block, padding + aligned))
     {
-        if (i > 0 && sep_len > 0)
+        /* Block data is always pointer aligned; stricter alignments may need
+         * up to `alignment - 1` bytes of padding in a fresh block. */
+        size_t worst = aligned + (alignment > sizeof(void *) ? alignment - 1 : 0);
+        if (worst > arena->block_size)
         {
-            strap_copy_bytes(write_ptr, sep, sep_len);
-            write_ptr += sep_len;
+            arena->alignment_padding += aligned - size;
+            return strap_arena_alloc_oversized(arena, aligned, worst, alignment);
         }
 
-        size_t part_len = lengths[i];
-        if (part_len > 0 && parts[i])
-        {
-            strap_copy_bytes(write_ptr, parts[i], part_len);
-            write_ptr += part_len;
-        }
+        block = strap_arena_advance(arena, worst);
+        if (!block)
+            return NULL;
+        padding = strap_align_padding(block->data + block->used, alignment);
     }
 
-    *write_ptr = '\0';
-    free(lengths);
+    void *memory = block->data + block->used + padding;
+    block->used += padding + aligned;
+
+    arena->alignment_padding += padding + (aligned - size);
+    arena->live_bytes += padding + aligned;
+    if (arena->live_bytes > arena->high_water_mark)
+        arena->high_water_mark = arena->live_bytes;
+
     strap_clear_error();
-    return result;
+    return memory;
 }
 
-char *strjoin(const char **parts, size_t nparts, const char *sep)
+void *strap_arena_alloc(strap_arena_t *arena, size_t size)
 {
-    return strjoin_impl(NULL, parts, nparts, sep);
+    if (!arena || size == 0)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    return strap_arena_alloc_impl(arena, size, arena->alignment);
 }
 
-char *strjoin_arena(strap_arena_t *arena, const char **parts, size_t nparts, const char *sep)
+void *strap_arena_alloc_aligned(strap_arena_t *arena, size_t size, size_t alignment)
 {
-    if (!arena)
+    if (!arena || size == 0 || !strap_is_power_of_two(alignment))
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return NULL;
     }
-    return strjoin_impl(arena, parts, nparts, sep);
+
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+    return strap_arena_alloc_impl(arena, size, alignment);
 }
 
-char *strjoin_va(const char *sep, ...)
+void *strap_arena_realloc(strap_arena_t *arena, void *ptr, size_t old_size, size_t new_size)
 {
-    va_list args;
-    va_start(args, sep);
+    if (!arena || new_size == 0)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
 
-    size_t count = 0;
-    const char *part;
-    while ((part = va_arg(args, const char *)) != NULL)
-        ++count;
-    va_end(args);
+    if (!ptr)
+        return strap_arena_alloc(arena, new_size);
 
-    if (count == 0)
+    size_t old_aligned = strap_align_size(old_size);
+    size_t new_aligned = strap_align_size(new_size);
+    if (old_aligned == SIZE_MAX || new_aligned == SIZE_MAX)
     {
-        char *empty = strdup("");
-        if (!empty)
-        {
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-        }
-        else
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
+
+    /* The most recent allocation ends exactly at the bump offset of the
+     * current block and can be resized without moving. */
+    struct strap_arena_block *block = arena->current;
+    unsigned char *bytes = ptr;
+    if (block && bytes >= block->data && old_aligned <= block->used &&
+        bytes == block->data + block->used - old_aligned)
+    {
+        size_t base = block->used - old_aligned;
+        if (new_aligned <= block->capacity - base ||
+            strap_arena_vm_grow(arena, block, new_aligned - old_aligned))
         {
+            block->used = base + new_aligned;
+            arena->live_bytes = arena->live_bytes - old_aligned + new_aligned;
+            if (arena->live_bytes > arena->high_water_mark)
+                arena->high_water_mark = arena->live_bytes;
             strap_clear_error();
+            return ptr;
         }
-        return empty;
     }
 
-    const char **parts_array = malloc(count * sizeof(char *));
-    if (!parts_array)
+    if (new_size <= old_size)
     {
-        errno = ENOMEM;
-        strap_set_error(STRAP_ERR_ALLOC);
-        return NULL;
+        strap_clear_error();
+        return ptr;
     }
 
-    va_start(args, sep);
-    for (size_t i = 0; i < count; ++i)
-        parts_array[i] = va_arg(args, const char *);
-    va_end(args);
+    void *moved = strap_arena_alloc(arena, new_size);
+    if (!moved)
+        return NULL;
 
-    char *result = strjoin(parts_array, count, sep);
-    free(parts_array);
-    return result;
+    if (old_size > 0)
+        memcpy(moved, ptr, old_size);
+    strap_clear_error();
+    return moved;
 }
 
-static int strap_strcasecmp_internal(const char *a, const char *b)
+int strap_arena_stats(const strap_arena_t *arena, strap_arena_stats_t *out)
 {
-    const unsigned char *ua = (const unsigned char *)a;
-    const unsigned char *ub = (const unsigned char *)b;
+    if (!arena || !out)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+
+    /* Blocks before the cursor can no longer be bump targets, so whatever
+     * they left unused is tail fragmentation. */
+    bool before_cursor = arena->current != NULL;
+    for (const struct strap_arena_block *block = arena->head; block; block = block->next)
+    {
+        out->block_count += 1;
+        out->bytes_reserved += block->capacity;
+        out->bytes_used += block->used;
+        if (block == arena->current)
+            before_cursor = false;
+        else if (before_cursor)
+            out->bytes_tail_waste += block->capacity - block->used;
+    }
 
-    while (*ua && *ub)
+    for (const struct strap_arena_block *block = arena->oversized; block; block = block->next)
     {
-        unsigned char ca = strap_ascii_tolower(*ua);
-        unsigned char cb = strap_ascii_tolower(*ub);
-        if (ca != cb)
-            return (int)ca - (int)cb;
-        ++ua;
-        ++ub;
+        out->block_count += 1;
+        out->bytes_reserved += block->capacity;
+        out->bytes_used += block->used;
     }
 
-    return (int)strap_ascii_tolower(*ua) - (int)strap_ascii_tolower(*ub);
+    out->bytes_alignment_padding = arena->alignment_padding;
+    out->high_water_mark = arena->high_water_mark;
+    out->oversized_allocs = arena->oversized_allocs;
+    strap_clear_error();
+    return 0;
 }
 
-int strap_strcasecmp(const char *a, const char *b)
+void strap_arena_stats_reset(strap_arena_t *arena)
 {
-    if (!a || !b)
+    if (!arena)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return 0;
+        return;
     }
 
-    int diff = strap_strcasecmp_internal(a, b);
+    arena->high_water_mark = arena->live_bytes;
+    arena->alignment_padding = 0;
+    arena->oversized_allocs = 0;
     strap_clear_error();
-    return diff;
 }
 
-bool strcaseeq(const char *a, const char *b)
+void strap_arena_set_block_callback(strap_arena_t *arena, strap_arena_block_fn callback, void *userdata)
 {
-    if (!a || !b)
+    if (!arena)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return false;
+        return;
     }
 
-    bool equal = (strap_strcasecmp_internal(a, b) == 0);
+    arena->on_block = callback;
+    arena->on_block_userdata = userdata;
     strap_clear_error();
-    return equal;
 }
 
-char **strsplit_limit(const char *s, const char *delim, size_t max_splits, size_t *out_count)
+char *strap_arena_strdup(strap_arena_t *arena, const char *s)
 {
-    if (!s || !delim)
+    if (!arena || !s)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return NULL;
     }
 
-    size_t delim_len = strlen(delim);
-    if (delim_len == 0)
+    size_t len = strlen(s);
+    if (strap_check_add_overflow(len, 1))
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
         return NULL;
     }
 
-    size_t max_tokens = 0;
-    if (max_splits > 0)
+    char *dst = strap_arena_alloc(arena, len + 1);
+    if (!dst)
+        return NULL;
+
+    memcpy(dst, s, len + 1);
+    strap_clear_error();
+    return dst;
+}
+
+char *strap_arena_strndup(strap_arena_t *arena, const char *s, size_t n)
+{
+    if (!arena || !s)
     {
-        if (strap_check_add_overflow(max_splits, 1))
-        {
-            errno = EOVERFLOW;
-            strap_set_error(STRAP_ERR_OVERFLOW);
-            return NULL;
-        }
-        max_tokens = max_splits + 1;
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
     }
 
-    size_t capacity = max_tokens > 0 ? max_tokens : 4;
-    if (strap_check_add_overflow(capacity, 1) ||
-        strap_check_mul_overflow(capacity + 1, sizeof(char *)))
+    if (strap_check_add_overflow(n, 1))
     {
         errno = EOVERFLOW;
         strap_set_error(STRAP_ERR_OVERFLOW);
         return NULL;
     }
 
-    char **tokens = malloc((capacity + 1) * sizeof(char *));
-    if (!tokens)
+    char *dst = strap_arena_alloc(arena, n + 1);
+    if (!dst)
+        return NULL;
+
+    memcpy(dst, s, n);
+    dst[n] = '\0';
+    strap_clear_error();
+    return dst;
+}
+
+/* Concurrent arena */
+strap_concurrent_arena_t *strap_concurrent_arena_create(size_t block_size)
+{
+    strap_concurrent_arena_t *arena = strap_mem_alloc(sizeof(*arena));
+    if (!arena)
     {
         errno = ENOMEM;
         strap_set_error(STRAP_ERR_ALLOC);
         return NULL;
     }
 
-    size_t count = 0;
-    size_t splits = 0;
-    const char *cursor = s;
+    arena->current = NULL;
+    arena->blocks = NULL;
+    arena->spare = NULL;
+    arena->oversized = NULL;
+    arena->block_size = block_size ? block_size : 4096;
+    strap_mutex_init(&arena->lock);
+    strap_clear_error();
+    return arena;
+}
 
-    for (;;)
-    {
-        if (max_splits > 0 && splits >= max_splits)
-        {
-            char *tail = strdup(cursor);
-            if (!tail)
-            {
-                errno = ENOMEM;
-                strap_set_error(STRAP_ERR_ALLOC);
-                strap_split_free_partial(tokens, count);
-                return NULL;
-            }
+void strap_concurrent_arena_destroy(strap_concurrent_arena_t *arena)
+{
+    if (!arena)
+        return;
 
-            if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
-            {
-                free(tail);
-                strap_split_free_partial(tokens, count);
-                return NULL;
-            }
+    strap_arena_free_list(arena->blocks, NULL);
+    strap_arena_free_list(arena->spare, NULL);
+    strap_arena_free_list(arena->oversized, NULL);
+    strap_mutex_destroy(&arena->lock);
+    strap_free(arena);
+}
 
-            tokens[count++] = tail;
-            break;
-        }
+void strap_concurrent_arena_clear(strap_concurrent_arena_t *arena)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return;
+    }
 
-        const char *match = strstr(cursor, delim);
-        if (!match)
-        {
-            size_t tail_len = strlen(cursor);
-            char *tail = malloc(tail_len + 1);
-            if (!tail)
-            {
-                errno = ENOMEM;
-                strap_set_error(STRAP_ERR_ALLOC);
-                strap_split_free_partial(tokens, count);
-                return NULL;
-            }
-            memcpy(tail, cursor, tail_len + 1);
+    strap_mutex_lock(&arena->lock);
+    strap_arena_free_list(arena->oversized, NULL);
+    arena->oversized = NULL;
 
-            if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
-            {
-                free(tail);
-                strap_split_free_partial(tokens, count);
-                return NULL;
-            }
+    struct strap_arena_block *block = arena->blocks;
+    while (block)
+    {
+        struct strap_arena_block *next = block->next;
+        block->used = 0;
+        block->next = arena->spare;
+        arena->spare = block;
+        block = next;
+    }
+    arena->blocks = NULL;
+    strap_atomic_store_ptr(&arena->current, NULL);
+    strap_mutex_unlock(&arena->lock);
+    strap_clear_error();
+}
 
-            tokens[count++] = tail;
-            break;
-        }
+/* Installs a new bump block unless another thread already replaced `seen`.
+ * Returns false only on allocation failure. */
+static bool strap_concurrent_arena_refill(strap_concurrent_arena_t *arena, void *seen)
+{
+    bool ok = true;
+    strap_mutex_lock(&arena->lock);
+    if (strap_atomic_load_ptr(&arena->current) == seen)
+    {
+        struct strap_arena_block *block = arena->spare;
+        if (block)
+            arena->spare = block->next;
+        else
+            block = strap_arena_new_block(arena->block_size);
 
-        size_t segment_len = (size_t)(match - cursor);
-        char *segment = malloc(segment_len + 1);
-        if (!segment)
+        if (block)
         {
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-            strap_split_free_partial(tokens, count);
-            return NULL;
+            block->next = arena->blocks;
+            arena->blocks = block;
+            strap_atomic_store_ptr(&arena->current, block);
         }
-
-        if (segment_len > 0)
-            memcpy(segment, cursor, segment_len);
-        segment[segment_len] = '\0';
-
-        if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
+        else
         {
-            free(segment);
-            strap_split_free_partial(tokens, count);
-            return NULL;
+            ok = false;
         }
-
-        tokens[count++] = segment;
-        cursor = match + delim_len;
-        ++splits;
     }
+    strap_mutex_unlock(&arena->lock);
+    return ok;
+}
 
-    if (strap_split_reserve(&tokens, &capacity, count, max_tokens) != 0)
-    {
-        strap_split_free_partial(tokens, count);
-        return NULL;
-    }
-
-    tokens[count] = NULL;
-    if (out_count)
-        *out_count = count;
-
-    strap_clear_error();
-    return tokens;
-}
-
-char **strsplit_predicate(const char *s,
-                          strap_split_predicate_fn predicate,
-                          void *userdata,
-                          size_t max_splits,
-                          size_t *out_count)
+void *strap_concurrent_arena_alloc(strap_concurrent_arena_t *arena, size_t size)
 {
-    if (!s || !predicate)
+    if (!arena || size == 0)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return NULL;
     }
 
-    size_t max_tokens = 0;
-    if (max_splits > 0)
-    {
-        if (strap_check_add_overflow(max_splits, 1))
-        {
-            errno = EOVERFLOW;
-            strap_set_error(STRAP_ERR_OVERFLOW);
-            return NULL;
-        }
-        max_tokens = max_splits + 1;
-    }
-
-    size_t capacity = max_tokens > 0 ? max_tokens : 4;
-    if (strap_check_add_overflow(capacity, 1) ||
-        strap_check_mul_overflow(capacity + 1, sizeof(char *)))
+    size_t aligned = strap_align_size(size);
+    if (aligned == SIZE_MAX)
     {
         errno = EOVERFLOW;
         strap_set_error(STRAP_ERR_OVERFLOW);
         return NULL;
     }
 
-    char **tokens = malloc((capacity + 1) * sizeof(char *));
-    if (!tokens)
+    if (aligned > arena->block_size)
     {
-        errno = ENOMEM;
-        strap_set_error(STRAP_ERR_ALLOC);
-        return NULL;
+        struct strap_arena_block *block = strap_arena_new_block(aligned);
+        if (!block)
+            return NULL;
+        block->used = aligned;
+        strap_mutex_lock(&arena->lock);
+        block->next = arena->oversized;
+        arena->oversized = block;
+        strap_mutex_unlock(&arena->lock);
+        strap_clear_error();
+        return block->data;
     }
 
-    size_t count = 0;
-    size_t splits = 0;
-    size_t pos = 0;
-    const unsigned char *buffer = (const unsigned char *)s;
-
-    while (buffer[pos] != '\0')
+    for (;;)
     {
-        while (buffer[pos] != '\0' && predicate(buffer[pos], userdata))
-            ++pos;
-        if (buffer[pos] == '\0')
-            break;
-
-        if (max_splits > 0 && splits >= max_splits)
+        struct strap_arena_block *block = strap_atomic_load_ptr(&arena->current);
+        if (block)
         {
-            char *tail = strdup((const char *)&buffer[pos]);
-            if (!tail)
-            {
-                errno = ENOMEM;
-                strap_set_error(STRAP_ERR_ALLOC);
-                strap_split_free_partial(tokens, count);
-                return NULL;
-            }
-
-            if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
+            size_t offset = strap_atomic_fetch_add_size((volatile size_t *)&block->used, aligned);
+            if (offset <= block->capacity && aligned <= block->capacity - offset)
             {
-                free(tail);
-                strap_split_free_partial(tokens, count);
-                return NULL;
+                strap_clear_error();
+                return block->data + offset;
             }
-
-            tokens[count++] = tail;
-            pos += strlen((const char *)&buffer[pos]);
-            break;
-        }
-
-        size_t start = pos;
-        while (buffer[pos] != '\0' && !predicate(buffer[pos], userdata))
-            ++pos;
-
-        size_t token_len = pos - start;
-        char *token = malloc(token_len + 1);
-        if (!token)
-        {
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-            strap_split_free_partial(tokens, count);
-            return NULL;
         }
 
-        if (token_len > 0)
-            memcpy(token, &buffer[start], token_len);
-        token[token_len] = '\0';
-
-        if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
-        {
-            free(token);
-            strap_split_free_partial(tokens, count);
+        if (!strap_concurrent_arena_refill(arena, block))
             return NULL;
-        }
-
-        tokens[count++] = token;
+    }
+}
 
-        if (buffer[pos] == '\0')
-            break;
+char *strap_concurrent_arena_strdup(strap_concurrent_arena_t *arena, const char *s)
+{
+    if (!arena || !s)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
 
-        ++splits;
+    size_t len = strlen(s);
+    if (strap_check_add_overflow(len, 1))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
     }
 
-    tokens[count] = NULL;
-    if (out_count)
-        *out_count = count;
+    char *dst = strap_concurrent_arena_alloc(arena, len + 1);
+    if (!dst)
+        return NULL;
 
+    memcpy(dst, s, len + 1);
     strap_clear_error();
-    return tokens;
-}
-
-void strsplit_free(char **tokens)
-{
-    if (!tokens)
-        return;
-    for (size_t i = 0; tokens[i] != NULL; ++i)
-        free(tokens[i]);
-    free(tokens);
+    return dst;
 }
 
-/* Trim */
-static char *strtrim_impl(strap_arena_t *arena, const char *s)
+/* Arena pool */
+strap_arena_pool_t *strap_arena_pool_create(const strap_arena_options_t *options, size_t max_retained_bytes)
 {
-    if (!s)
+    strap_arena_options_t defaults;
+    if (!options)
+    {
+        strap_arena_options_init(&defaults);
+        options = &defaults;
+    }
+    else if (options->alignment != 0 && !strap_is_power_of_two(options->alignment))
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return NULL;
     }
 
-    const unsigned char *bytes = (const unsigned char *)s;
-    size_t total_len = strlen(s);
-
-    size_t leading = strap_trim_leading_ascii_simd(bytes, total_len);
-    const unsigned char *start = bytes;
-
-    if (leading == SIZE_MAX)
-    {
-        leading = 0;
-        while (leading < total_len && isspace((unsigned char)start[0]))
-        {
-            ++start;
-            ++leading;
-        }
-    }
-    else
+    strap_arena_pool_t *pool = strap_mem_alloc(sizeof(*pool));
+    if (!pool)
     {
-        start += leading;
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
     }
 
-    size_t remaining_len = total_len - leading;
-    size_t trimmed_len = strap_trim_trailing_ascii_simd(start, remaining_len);
-    size_t len;
+    pool->options = *options;
+    pool->id = strap_atomic_fetch_add_size(&strap_arena_pool_next_id, 1);
+    pool->max_retained = max_retained_bytes;
+    pool->retained = 0;
+    pool->free_list = NULL;
+    strap_mutex_init(&pool->lock);
 
-    if (trimmed_len == SIZE_MAX)
+    strap_mutex_lock(&strap_arena_pool_live_lock);
+    pool->live_next = strap_arena_pool_live;
+    strap_arena_pool_live = pool;
+    strap_mutex_unlock(&strap_arena_pool_live_lock);
+    strap_clear_error();
+    return pool;
+}
+
+void strap_arena_pool_destroy(strap_arena_pool_t *pool)
+{
+    if (!pool)
+        return;
+
+    strap_mutex_lock(&strap_arena_pool_live_lock);
+    struct strap_arena_pool **link = &strap_arena_pool_live;
+    while (*link != pool)
+        link = &(*link)->live_next;
+    *link = pool->live_next;
+    strap_mutex_unlock(&strap_arena_pool_live_lock);
+
+    if (strap_arena_pool_cache && strap_arena_pool_cache_id == pool->id)
     {
-        len = remaining_len;
-        while (len > 0 && isspace((unsigned char)start[len - 1]))
-            --len;
+        strap_arena_destroy(strap_arena_pool_cache);
+        strap_arena_pool_cache = NULL;
+        strap_arena_pool_cache_id = 0;
     }
-    else
+
+    struct strap_arena *arena = pool->free_list;
+    while (arena)
     {
-        len = trimmed_len;
+        struct strap_arena *next = arena->pool_next;
+        strap_arena_destroy(arena);
+        arena = next;
     }
+    strap_mutex_destroy(&pool->lock);
+    strap_free(pool);
+}
 
-    if (strap_check_add_overflow(len, 1))
+strap_arena_t *strap_arena_pool_acquire(strap_arena_pool_t *pool)
+{
+    if (!pool)
     {
-        errno = EOVERFLOW;
-        strap_set_error(STRAP_ERR_OVERFLOW);
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return NULL;
     }
 
-    char *result;
-    if (arena)
+    if (strap_arena_pool_cache && strap_arena_pool_cache_id == pool->id)
     {
-        result = strap_arena_alloc(arena, len + 1);
-        if (!result)
-            return NULL;
+        strap_arena_t *arena = strap_arena_pool_cache;
+        strap_arena_pool_cache = NULL;
+        strap_arena_pool_cache_id = 0;
+        strap_mutex_lock(&pool->lock);
+        pool->retained -= arena->reserved;
+        strap_mutex_unlock(&pool->lock);
+        strap_clear_error();
+        return arena;
     }
-    else
+
+    strap_mutex_lock(&pool->lock);
+    strap_arena_t *arena = pool->free_list;
+    if (arena)
     {
-        result = malloc(len + 1);
-        if (!result)
-        {
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-            return NULL;
-        }
+        pool->free_list = arena->pool_next;
+        pool->retained -= arena->reserved;
     }
+    strap_mutex_unlock(&pool->lock);
 
-    if (len > 0)
-        memcpy(result, start, len);
-    result[len] = '\0';
+    if (!arena)
+        return strap_arena_create_ex(&pool->options);
 
+    arena->pool_next = NULL;
     strap_clear_error();
-    return result;
-}
-
-char *strtrim(const char *s)
-{
-    return strtrim_impl(NULL, s);
+    return arena;
 }
 
-char *strtrim_arena(strap_arena_t *arena, const char *s)
+/* Empties this thread's slot into the owning pool's shared list, or
+ * destroys the arena when that pool is gone. The arena is already charged
+ * to the pool. */
+static void strap_arena_pool_evict_thread_cache(void)
 {
+    strap_arena_t *arena = strap_arena_pool_cache;
     if (!arena)
+        return;
+
+    strap_mutex_lock(&strap_arena_pool_live_lock);
+    strap_arena_pool_t *pool = strap_arena_pool_live;
+    while (pool && pool->id != strap_arena_pool_cache_id)
+        pool = pool->live_next;
+    if (pool)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        strap_mutex_lock(&pool->lock);
+        arena->pool_next = pool->free_list;
+        pool->free_list = arena;
+        strap_mutex_unlock(&pool->lock);
     }
-    return strtrim_impl(arena, s);
+    strap_mutex_unlock(&strap_arena_pool_live_lock);
+
+    if (!pool)
+        strap_arena_destroy(arena);
+    strap_arena_pool_cache = NULL;
+    strap_arena_pool_cache_id = 0;
 }
 
-void strtrim_inplace(char *s)
+void strap_arena_pool_release(strap_arena_pool_t *pool, strap_arena_t *arena)
 {
-    if (!s)
+    if (!pool || !arena)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return;
     }
 
-    unsigned char *start = (unsigned char *)s;
-    while (*start && isspace(*start))
-        ++start;
+    strap_arena_clear(arena);
+    strap_arena_stats_reset(arena);
+    arena->on_block = NULL;
+    arena->on_block_userdata = NULL;
 
-    if ((char *)start != s)
-        memmove(s, start, strlen((const char *)start) + 1);
+    if (strap_arena_pool_cache && strap_arena_pool_cache_id != pool->id)
+        strap_arena_pool_evict_thread_cache();
 
-    size_t len = strlen(s);
-    while (len > 0 && isspace((unsigned char)s[len - 1]))
+    /* Trim to the remaining budget, then keep the arena in the free slot or
+     * on the shared list. An arena left with nothing to reuse, or still over
+     * budget because its first VM commit step cannot be trimmed, is
+     * destroyed so neither the cap nor the list length is exceeded. */
+    strap_mutex_lock(&pool->lock);
+    size_t budget = pool->max_retained > pool->retained ? pool->max_retained - pool->retained : 0;
+    if (arena->reserved > budget)
+        strap_arena_trim(arena, budget);
+    bool keep = arena->reserved != 0 && arena->reserved <= budget;
+    if (keep)
     {
-        s[len - 1] = '\0';
-        --len;
+        pool->retained += arena->reserved;
+        if (!strap_arena_pool_cache)
+        {
+            strap_arena_pool_cache = arena;
+            strap_arena_pool_cache_id = pool->id;
+        }
+        else
+        {
+            arena->pool_next = pool->free_list;
+            pool->free_list = arena;
+        }
     }
+    strap_mutex_unlock(&pool->lock);
 
+    if (!keep)
+        strap_arena_destroy(arena);
+    else if (strap_arena_pool_cache == arena)
+        strap_thread_exit_arm();
     strap_clear_error();
 }
 
-bool strstartswith(const char *s, const char *prefix)
+void strap_arena_pool_flush_thread_cache(strap_arena_pool_t *pool)
 {
-    if (!s || !prefix)
+    if (!pool || strap_arena_pool_cache_id == pool->id)
+        strap_arena_pool_evict_thread_cache();
+}
+
+size_t strap_arena_pool_retained(strap_arena_pool_t *pool)
+{
+    if (!pool)
+        return 0;
+
+    strap_mutex_lock(&pool->lock);
+    size_t retained = pool->retained;
+    strap_mutex_unlock(&pool->lock);
+    return retained;
+}
+
+/* Slab allocator */
+strap_slab_t *strap_slab_create(void)
+{
+    strap_slab_t *slab = strap_mem_alloc(sizeof(*slab));
+    if (!slab)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return false;
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
     }
 
-    size_t prefix_len = strlen(prefix);
-    bool matches = strncmp(s, prefix, prefix_len) == 0;
+    memset(slab, 0, sizeof(*slab));
+    slab->id = strap_atomic_fetch_add_size(&strap_slab_next_id, 1);
+    strap_mutex_init(&slab->lock);
+
+    strap_mutex_lock(&strap_slab_live_lock);
+    slab->live_next = strap_slab_live;
+    strap_slab_live = slab;
+    strap_mutex_unlock(&strap_slab_live_lock);
     strap_clear_error();
-    return matches;
+    return slab;
 }
 
-bool strendswith(const char *s, const char *suffix)
+void strap_slab_destroy(strap_slab_t *slab)
 {
-    if (!s || !suffix)
+    if (!slab)
+        return;
+
+    strap_mutex_lock(&strap_slab_live_lock);
+    struct strap_slab **link = &strap_slab_live;
+    while (*link != slab)
+        link = &(*link)->live_next;
+    *link = slab->live_next;
+    strap_mutex_unlock(&strap_slab_live_lock);
+
+    for (unsigned i = 0; i < STRAP_SLAB_THREAD_SLABS; ++i)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return false;
+        if (strap_slab_caches[i].slab_id == slab->id)
+            memset(&strap_slab_caches[i], 0, sizeof(strap_slab_caches[i]));
     }
 
-    size_t s_len = strlen(s);
-    size_t suffix_len = strlen(suffix);
-    if (suffix_len > s_len)
+    struct strap_slab_registry *registry = slab->registry;
+    if (registry)
     {
-        strap_clear_error();
-        return false;
+        for (size_t i = 0; i < registry->count; ++i)
+            strap_free((void *)registry->chunks[i].base);
+        strap_free(registry);
     }
 
-    bool matches = strncmp(s + (s_len - suffix_len), suffix, suffix_len) == 0;
-    strap_clear_error();
-    return matches;
+    while (slab->retired)
+    {
+        struct strap_slab_registry *next = slab->retired->retired_next;
+        strap_free(slab->retired);
+        slab->retired = next;
+    }
+
+    strap_mutex_destroy(&slab->lock);
+    strap_free(slab);
 }
 
-static char *strreplace_impl(strap_arena_t *arena, const char *s, const char *search, const char *replacement)
+static unsigned strap_slab_class_of(size_t size)
 {
-    if (!s || !search)
+    unsigned size_class = 0;
+    size_t class_size = STRAP_SLAB_MIN_SIZE;
+    while (class_size < size)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        class_size <<= 1;
+        ++size_class;
     }
+    return size_class;
+}
 
-    if (!replacement)
-        replacement = "";
+/* Returns the size class of the chunk holding `ptr`, or -1 when `ptr` was
+ * not carved from this slab. */
+static int strap_slab_lookup(const strap_slab_t *slab, const void *ptr)
+{
+    const struct strap_slab_registry *registry = strap_atomic_load_ptr(&slab->registry);
+    if (!registry)
+        return -1;
 
-    size_t search_len = strlen(search);
-    if (search_len == 0)
+    uintptr_t address = (uintptr_t)ptr;
+    size_t lo = 0;
+    size_t hi = registry->count;
+    while (lo < hi)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        size_t mid = lo + (hi - lo) / 2;
+        if (registry->chunks[mid].base <= address)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
-    size_t replace_len = strlen(replacement);
-    size_t count = 0;
+    if (lo == 0 || address - registry->chunks[lo - 1].base >= STRAP_SLAB_CHUNK_SIZE)
+        return -1;
+    return (int)registry->chunks[lo - 1].size_class;
+}
 
-    const char *cursor = s;
-    while ((cursor = strstr(cursor, search)) != NULL)
-    {
-        ++count;
-        cursor += search_len;
-    }
+/* Publishes a copy of the registry that includes `chunk`. Caller holds the lock. */
+static bool strap_slab_register(strap_slab_t *slab, unsigned char *chunk, unsigned size_class)
+{
+    struct strap_slab_registry *old = slab->registry;
+    size_t count = old ? old->count : 0;
+    struct strap_slab_registry *registry =
+        strap_mem_alloc(sizeof(*registry) + (count + 1) * sizeof(struct strap_slab_chunk_ref));
+    if (!registry)
+        return false;
 
-    if (count == 0)
+    uintptr_t base = (uintptr_t)chunk;
+    size_t at = 0;
+    while (at < count && old->chunks[at].base < base)
     {
-        if (arena)
-            return strap_arena_strdup(arena, s);
-
-        char *copy = strdup(s);
-        if (!copy)
-        {
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-        }
-        else
-        {
-            strap_clear_error();
-        }
-        return copy;
+        registry->chunks[at] = old->chunks[at];
+        ++at;
     }
+    registry->chunks[at].base = base;
+    registry->chunks[at].size_class = size_class;
+    for (size_t i = at; i < count; ++i)
+        registry->chunks[i + 1] = old->chunks[i];
 
-    size_t base_len = strlen(s);
-    size_t total_len = base_len;
+    registry->retired_next = NULL;
+    registry->count = count + 1;
+    strap_atomic_store_ptr(&slab->registry, registry);
 
-    if (replace_len >= search_len)
-    {
-        size_t diff = replace_len - search_len;
-        if (strap_check_mul_overflow(count, diff))
-        {
-            errno = EOVERFLOW;
-            strap_set_error(STRAP_ERR_OVERFLOW);
-            return NULL;
-        }
-        size_t increase = count * diff;
-        if (strap_check_add_overflow(total_len, increase))
-        {
-            errno = EOVERFLOW;
-            strap_set_error(STRAP_ERR_OVERFLOW);
-            return NULL;
-        }
-        total_len += increase;
-    }
-    else
+    if (old)
     {
-        size_t diff = search_len - replace_len;
-        size_t decrease = count * diff;
-        if (decrease > total_len)
-        {
-            errno = EOVERFLOW;
-            strap_set_error(STRAP_ERR_OVERFLOW);
-            return NULL;
-        }
-        total_len -= decrease;
+        old->retired_next = slab->retired;
+        slab->retired = old;
     }
+    return true;
+}
 
-    if (strap_check_add_overflow(total_len, 1))
-    {
-        errno = EOVERFLOW;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return NULL;
-    }
+static void strap_slab_return(strap_slab_t *slab, strap_slab_cache_t *cache, unsigned size_class, size_t count);
 
-    char *result;
-    if (arena)
-    {
-        result = strap_arena_alloc(arena, total_len + 1);
-        if (!result)
-            return NULL;
-    }
-    else
+/* Empties `cache` into its slab's shared lists if the slab is still alive. */
+static void strap_slab_cache_evict(strap_slab_cache_t *cache)
+{
+    bool cached = false;
+    for (unsigned size_class = 0; size_class < STRAP_SLAB_CLASS_COUNT; ++size_class)
+        cached = cached || cache->heads[size_class] != NULL;
+
+    if (cached)
     {
-        result = malloc(total_len + 1);
-        if (!result)
+        strap_mutex_lock(&strap_slab_live_lock);
+        for (strap_slab_t *slab = strap_slab_live; slab; slab = slab->live_next)
         {
-            errno = ENOMEM;
-            strap_set_error(STRAP_ERR_ALLOC);
-            return NULL;
+            if (slab->id != cache->slab_id)
+                continue;
+            for (unsigned size_class = 0; size_class < STRAP_SLAB_CLASS_COUNT; ++size_class)
+                strap_slab_return(slab, cache, size_class, cache->counts[size_class]);
+            break;
         }
+        strap_mutex_unlock(&strap_slab_live_lock);
     }
+    memset(cache, 0, sizeof(*cache));
+}
 
-    const char *src = s;
-    char *dst = result;
-    const char *match;
-
-    while ((match = strstr(src, search)) != NULL)
+/* Returns this thread's cache for `slab`, evicting the least recently
+ * claimed slot when every slot belongs to another slab. */
+static strap_slab_cache_t *strap_slab_thread_cache(const strap_slab_t *slab)
+{
+    for (unsigned i = 0; i < STRAP_SLAB_THREAD_SLABS; ++i)
     {
-        size_t segment_len = (size_t)(match - src);
-        memcpy(dst, src, segment_len);
-        dst += segment_len;
-        if (replace_len > 0)
-        {
-            memcpy(dst, replacement, replace_len);
-            dst += replace_len;
-        }
-        src = match + search_len;
+        if (strap_slab_caches[i].slab_id == slab->id)
+            return &strap_slab_caches[i];
     }
 
-    size_t tail_len = strlen(src);
-    memcpy(dst, src, tail_len);
-    dst += tail_len;
-    *dst = '\0';
-
-    strap_clear_error();
-    return result;
+    strap_slab_cache_t *cache = &strap_slab_caches[strap_slab_cache_victim];
+    strap_slab_cache_victim = (strap_slab_cache_victim + 1) % STRAP_SLAB_THREAD_SLABS;
+    if (cache->slab_id != 0)
+        strap_slab_cache_evict(cache);
+    cache->slab_id = slab->id;
+    strap_thread_exit_arm();
+    return cache;
 }
 
-char *strreplace(const char *s, const char *search, const char *replacement)
+/* Moves up to a batch of objects of `size_class` from the shared list, or
+ * freshly carved ones, into the thread cache. */
+static bool strap_slab_refill(strap_slab_t *slab, strap_slab_cache_t *cache, unsigned size_class)
 {
-    return strreplace_impl(NULL, s, search, replacement);
-}
+    size_t size = (size_t)STRAP_SLAB_MIN_SIZE << size_class;
+    void *head = cache->heads[size_class];
+    size_t count = cache->counts[size_class];
 
-char *strreplace_arena(strap_arena_t *arena, const char *s, const char *search, const char *replacement)
-{
-    if (!arena)
+    strap_mutex_lock(&slab->lock);
+    while (count < STRAP_SLAB_BATCH && slab->classes[size_class].free_list)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        void *object = slab->classes[size_class].free_list;
+        slab->classes[size_class].free_list = *(void **)object;
+        *(void **)object = head;
+        head = object;
+        ++count;
     }
-    return strreplace_impl(arena, s, search, replacement);
-}
 
-static char *strap_locale_case_impl(strap_arena_t *arena, const char *s, const char *locale_name, int make_upper)
-{
-    if (!s)
+    while (count < STRAP_SLAB_BATCH)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        if (slab->classes[size_class].remaining < size)
+        {
+            if (count > 0)
+                break;
+
+            unsigned char *chunk = strap_mem_alloc(STRAP_SLAB_CHUNK_SIZE);
+            if (!chunk || !strap_slab_register(slab, chunk, size_class))
+            {
+                strap_mutex_unlock(&slab->lock);
+                strap_free(chunk);
+                errno = ENOMEM;
+                strap_set_error(STRAP_ERR_ALLOC);
+                return false;
+            }
+            slab->classes[size_class].bump = chunk;
+            slab->classes[size_class].remaining = STRAP_SLAB_CHUNK_SIZE;
+        }
+
+        void *object = slab->classes[size_class].bump;
+        slab->classes[size_class].bump += size;
+        slab->classes[size_class].remaining -= size;
+        *(void **)object = head;
+        head = object;
+        ++count;
     }
+    strap_mutex_unlock(&slab->lock);
 
-    strap_locale_ctx ctx;
-    if (strap_locale_enter(locale_name, &ctx) != 0)
-        return NULL;
+    cache->heads[size_class] = head;
+    cache->counts[size_class] = count;
+    return true;
+}
 
-    size_t len = strlen(s);
-    if (strap_check_add_overflow(len, 1))
+void *strap_slab_alloc(strap_slab_t *slab, size_t size)
+{
+    if (!slab || size == 0)
     {
-        strap_locale_exit(&ctx);
-        errno = EOVERFLOW;
-        strap_set_error(STRAP_ERR_OVERFLOW);
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return NULL;
     }
 
-    char *buffer;
-    if (arena)
-    {
-        buffer = strap_arena_alloc(arena, len + 1);
-        if (!buffer)
-        {
-            strap_locale_exit(&ctx);
-            return NULL;
-        }
-    }
-    else
+    if (size > STRAP_SLAB_MAX_SIZE)
     {
-        buffer = malloc(len + 1);
-        if (!buffer)
+        void *large = strap_mem_alloc(size);
+        if (!large)
         {
-            strap_locale_exit(&ctx);
             errno = ENOMEM;
             strap_set_error(STRAP_ERR_ALLOC);
             return NULL;
         }
+        strap_clear_error();
+        return large;
     }
 
-    for (size_t i = 0; i < len; ++i)
-    {
-        unsigned char ch = (unsigned char)s[i];
-        int converted = make_upper ? strap_toupper_locale_ctx(ch, &ctx) : strap_tolower_locale_ctx(ch, &ctx);
-        buffer[i] = (char)converted;
-    }
-    buffer[len] = '\0';
+    unsigned size_class = strap_slab_class_of(size);
+    strap_slab_cache_t *cache = strap_slab_thread_cache(slab);
+    if (!cache->heads[size_class] && !strap_slab_refill(slab, cache, size_class))
+        return NULL;
 
-    strap_locale_exit(&ctx);
+    void *object = cache->heads[size_class];
+    cache->heads[size_class] = *(void **)object;
+    cache->counts[size_class] -= 1;
     strap_clear_error();
-    return buffer;
+    return object;
 }
 
-char *strtolower_locale(const char *s, const char *locale_name)
+/* Hands `count` objects from the front of the thread list back to the slab. */
+static void strap_slab_return(strap_slab_t *slab, strap_slab_cache_t *cache, unsigned size_class, size_t count)
 {
-    return strap_locale_case_impl(NULL, s, locale_name, 0);
+    strap_mutex_lock(&slab->lock);
+    for (size_t i = 0; i < count && cache->heads[size_class]; ++i)
+    {
+        void *object = cache->heads[size_class];
+        cache->heads[size_class] = *(void **)object;
+        cache->counts[size_class] -= 1;
+        *(void **)object = slab->classes[size_class].free_list;
+        slab->classes[size_class].free_list = object;
+    }
+    strap_mutex_unlock(&slab->lock);
 }
 
-char *strtolower_locale_arena(strap_arena_t *arena, const char *s, const char *locale_name)
+void strap_slab_free(strap_slab_t *slab, void *ptr)
 {
-    if (!arena)
+    if (!ptr)
+        return;
+    if (!slab)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        return;
+    }
+
+    int size_class = strap_slab_lookup(slab, ptr);
+    if (size_class < 0)
+    {
+        strap_free(ptr);
+        return;
     }
-    return strap_locale_case_impl(arena, s, locale_name, 0);
+
+    strap_slab_cache_t *cache = strap_slab_thread_cache(slab);
+    *(void **)ptr = cache->heads[size_class];
+    cache->heads[size_class] = ptr;
+    cache->counts[size_class] += 1;
+    if (cache->counts[size_class] > STRAP_SLAB_CACHE_LIMIT)
+        strap_slab_return(slab, cache, (unsigned)size_class, STRAP_SLAB_CACHE_LIMIT / 2);
 }
 
-char *strtoupper_locale(const char *s, const char *locale_name)
+void strap_slab_flush_thread_cache(strap_slab_t *slab)
 {
-    return strap_locale_case_impl(NULL, s, locale_name, 1);
+    if (!slab)
+        return;
+
+    for (unsigned i = 0; i < STRAP_SLAB_THREAD_SLABS; ++i)
+    {
+        strap_slab_cache_t *cache = &strap_slab_caches[i];
+        if (cache->slab_id != slab->id)
+            continue;
+        for (unsigned size_class = 0; size_class < STRAP_SLAB_CLASS_COUNT; ++size_class)
+            strap_slab_return(slab, cache, size_class, cache->counts[size_class]);
+    }
 }
 
-char *strtoupper_locale_arena(strap_arena_t *arena, const char *s, const char *locale_name)
+static void strap_thread_exit_flush(void)
 {
-    if (!arena)
+    strap_timer_reset();
+    strap_arena_pool_evict_thread_cache();
+    for (unsigned i = 0; i < STRAP_SLAB_THREAD_SLABS; ++i)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return NULL;
+        if (strap_slab_caches[i].slab_id != 0)
+            strap_slab_cache_evict(&strap_slab_caches[i]);
     }
-    return strap_locale_case_impl(arena, s, locale_name, 1);
 }
 
-int strcoll_locale(const char *a, const char *b, const char *locale_name)
+char *strap_slab_strdup(strap_slab_t *slab, const char *s)
 {
-    if (!a || !b)
+    if (!slab || !s)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return 0;
+        return NULL;
     }
 
-    strap_locale_ctx ctx;
-    if (strap_locale_enter(locale_name, &ctx) != 0)
-        return 0;
-
-    int cmp;
-    if (ctx.kind == STRAP_LOCALE_HANDLE)
-    {
-#if defined(_WIN32)
-        cmp = _strcoll_l(a, b, ctx.handle);
-#else
-        cmp = strcoll_l(a, b, ctx.handle);
-#endif
-    }
-    else
+    size_t len = strlen(s);
+    if (strap_check_add_overflow(len, 1))
     {
-        cmp = strcoll(a, b);
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
     }
 
-    strap_locale_exit(&ctx);
+    char *dst = strap_slab_alloc(slab, len + 1);
+    if (!dst)
+        return NULL;
+
+    memcpy(dst, s, len + 1);
     strap_clear_error();
-    return cmp;
+    return dst;
 }
 
-int strcasecmp_locale(const char *a, const char *b, const char *locale_name)
+/* String manipulation */
+static char *strjoin_impl(strap_arena_t *arena, strap_slab_t *slab, const char **parts, size_t nparts, const char *sep)
 {
-    if (!a || !b)
+    if (!parts || nparts == 0)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return 0;
-    }
-
-    strap_locale_ctx ctx;
-    if (strap_locale_enter(locale_name, &ctx) != 0)
-        return 0;
-
-    const unsigned char *pa = (const unsigned char *)a;
-    const unsigned char *pb = (const unsigned char *)b;
+        if (arena || slab)
+        {
+            char *empty = arena ? strap_arena_alloc(arena, 1) : strap_slab_alloc(slab, 1);
+            if (!empty)
+                return NULL;
+            empty[0] = '\0';
+            strap_clear_error();
+            return empty;
+        }
 
-    while (*pa && *pb)
-    {
-        int ca = strap_tolower_locale_ctx(*pa, &ctx);
-        int cb = strap_tolower_locale_ctx(*pb, &ctx);
-        if (ca != cb)
+        char *empty = strap_mem_strdup("");
+        if (!empty)
+        {
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+        }
+        else
         {
-            strap_locale_exit(&ctx);
             strap_clear_error();
-            return ca - cb;
         }
-        ++pa;
-        ++pb;
+        return empty;
+    }
+
+    size_t sep_len = sep ? strlen(sep) : 0;
+    size_t *lengths = strap_mem_alloc(nparts * sizeof(size_t));
+    if (!lengths)
+    {
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
+    }
+
+    size_t total_len = 1; /* null terminator */
+
+    for (size_t i = 0; i < nparts; ++i)
+    {
+        size_t part_len = parts[i] ? strlen(parts[i]) : 0;
+        lengths[i] = part_len;
+
+        if (strap_check_add_overflow(total_len, part_len))
+        {
+            strap_free(lengths);
+            errno = EOVERFLOW;
+            strap_set_error(STRAP_ERR_OVERFLOW);
+            return NULL;
+        }
+        total_len += part_len;
+
+        if (i + 1 < nparts && sep_len > 0)
+        {
+            if (strap_check_add_overflow(total_len, sep_len))
+            {
+                strap_free(lengths);
+                errno = EOVERFLOW;
+                strap_set_error(STRAP_ERR_OVERFLOW);
+                return NULL;
+            }
+            total_len += sep_len;
+        }
+    }
+
+    char *result;
+    if (arena || slab)
+    {
+        result = arena ? strap_arena_alloc(arena, total_len) : strap_slab_alloc(slab, total_len);
+        if (!result)
+        {
+            strap_free(lengths);
+            return NULL;
+        }
+    }
+    else
+    {
+        result = strap_mem_alloc(total_len);
+        if (!result)
+        {
+            strap_free(lengths);
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+            return NULL;
+        }
+    }
+
+    char *write_ptr = result;
+    for (size_t i = 0; i < nparts; ++i)
+    {
+        if (i > 0 && sep_len > 0)
+        {
+            strap_copy_bytes(write_ptr, sep, sep_len);
+            write_ptr += sep_len;
+        }
+
+        size_t part_len = lengths[i];
+        if (part_len > 0 && parts[i])
+        {
+            strap_copy_bytes(write_ptr, parts[i], part_len);
+            write_ptr += part_len;
+        }
+    }
+
+    *write_ptr = '\0';
+    strap_free(lengths);
+    strap_clear_error();
+    return result;
+}
+
+char *strjoin(const char **parts, size_t nparts, const char *sep)
+{
+    return strjoin_impl(NULL, NULL, parts, nparts, sep);
+}
+
+char *strjoin_arena(strap_arena_t *arena, const char **parts, size_t nparts, const char *sep)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strjoin_impl(arena, NULL, parts, nparts, sep);
+}
+
+char *strjoin_slab(strap_slab_t *slab, const char **parts, size_t nparts, const char *sep)
+{
+    if (!slab)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strjoin_impl(NULL, slab, parts, nparts, sep);
+}
+
+char *strjoin_va(const char *sep, ...)
+{
+    va_list args;
+    va_start(args, sep);
+
+    size_t count = 0;
+    const char *part;
+    while ((part = va_arg(args, const char *)) != NULL)
+        ++count;
+    va_end(args);
+
+    if (count == 0)
+    {
+        char *empty = strap_mem_strdup("");
+        if (!empty)
+        {
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+        }
+        else
+        {
+            strap_clear_error();
+        }
+        return empty;
+    }
+
+    const char **parts_array = strap_mem_alloc(count * sizeof(char *));
+    if (!parts_array)
+    {
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
+    }
+
+    va_start(args, sep);
+    for (size_t i = 0; i < count; ++i)
+        parts_array[i] = va_arg(args, const char *);
+    va_end(args);
+
+    char *result = strjoin(parts_array, count, sep);
+    strap_free(parts_array);
+    return result;
+}
+
+static uint64_t strap_ascii_fold64(uint64_t word)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t heptets = word & (0x7F * ones);
+    uint64_t at_least_a = heptets + (0x80 - 'A') * ones;
+    uint64_t above_z = heptets + (0x80 - 'Z' - 1) * ones;
+    uint64_t is_upper = (at_least_a ^ above_z) & ~word & (0x80 * ones);
+    return word | (is_upper >> 2);
+}
+
+/* Returns the first index below `n` where the ASCII-folded bytes differ, or
+ * `n` when the prefixes match. */
+static size_t strap_ascii_casecmp_prefix(const unsigned char *a, const unsigned char *b, size_t n)
+{
+    size_t i = 0;
+
+#if STRAP_HAVE_SSE2
+    for (; i + 32 <= n; i += 32)
+    {
+        __m128i a0 = strap_ascii_flip_case16(_mm_loadu_si128((const __m128i *)(a + i)), 'A');
+        __m128i b0 = strap_ascii_flip_case16(_mm_loadu_si128((const __m128i *)(b + i)), 'A');
+        __m128i a1 = strap_ascii_flip_case16(_mm_loadu_si128((const __m128i *)(a + i + 16)), 'A');
+        __m128i b1 = strap_ascii_flip_case16(_mm_loadu_si128((const __m128i *)(b + i + 16)), 'A');
+        unsigned lo = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a0, b0));
+        unsigned hi = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a1, b1));
+        unsigned mismatch = ~(lo | (hi << 16));
+        if (mismatch)
+            return i + strap_ctz16(mismatch);
+    }
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i va = strap_ascii_flip_case16(_mm_loadu_si128((const __m128i *)(a + i)), 'A');
+        __m128i vb = strap_ascii_flip_case16(_mm_loadu_si128((const __m128i *)(b + i)), 'A');
+        unsigned mismatch = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xFFFFU;
+        if (mismatch)
+            return i + strap_ctz16(mismatch);
+    }
+#else
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, sizeof(wa));
+        memcpy(&wb, b + i, sizeof(wb));
+        if (strap_ascii_fold64(wa) != strap_ascii_fold64(wb))
+            break;
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        if (strap_ascii_tolower(a[i]) != strap_ascii_tolower(b[i]))
+            return i;
+    }
+    return n;
+}
+
+static int strap_strcasecmp_n_internal(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    const unsigned char *ua = (const unsigned char *)a;
+    const unsigned char *ub = (const unsigned char *)b;
+    size_t n = a_len < b_len ? a_len : b_len;
+
+    size_t i = strap_ascii_casecmp_prefix(ua, ub, n);
+    if (i < n)
+        return (int)strap_ascii_tolower(ua[i]) - (int)strap_ascii_tolower(ub[i]);
+    if (a_len == b_len)
+        return 0;
+
+    /* The shorter string sorts first; mirror the NUL-terminated result. */
+    if (a_len > b_len)
+        return ua[n] ? (int)strap_ascii_tolower(ua[n]) : 1;
+    return ub[n] ? -(int)strap_ascii_tolower(ub[n]) : -1;
+}
+
+/* True when an 8-byte load at `p` stays inside its page. */
+static bool strap_word_in_page(const unsigned char *p)
+{
+    return ((uintptr_t)p & (STRAP_MIN_PAGE_SIZE - 1)) <= STRAP_MIN_PAGE_SIZE - 8;
+}
+
+/* Folds and compares eight bytes at a time until the words differ or `a`
+ * holds a NUL, then settles that word byte by byte. A NUL in `a` inside
+ * matching words is matched in `b` too, so one check covers both. */
+STRAP_NO_SANITIZE_ADDRESS
+static int strap_strcasecmp_nul(const unsigned char *a, const unsigned char *b)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    size_t i = 0;
+    for (;;)
+    {
+        if (strap_word_in_page(a + i) && strap_word_in_page(b + i))
+        {
+            uint64_t wa, wb;
+            memcpy(&wa, a + i, sizeof(wa));
+            memcpy(&wb, b + i, sizeof(wb));
+            uint64_t has_nul = (wa - ones) & ~wa & (0x80 * ones);
+            if (!has_nul && strap_ascii_fold64(wa) == strap_ascii_fold64(wb))
+            {
+                i += 8;
+                continue;
+            }
+        }
+
+        for (size_t end = i + 8; i < end; ++i)
+        {
+            int ca = strap_ascii_tolower(a[i]);
+            int cb = strap_ascii_tolower(b[i]);
+            if (ca != cb || ca == 0)
+                return ca - cb;
+        }
+    }
+}
+
+int strap_strcasecmp(const char *a, const char *b)
+{
+    if (!a || !b)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    int diff = strap_strcasecmp_nul((const unsigned char *)a, (const unsigned char *)b);
+    strap_clear_error();
+    return diff;
+}
+
+int strap_strcasecmp_n(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    if (!a || !b)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    int diff = strap_strcasecmp_n_internal(a, a_len, b, b_len);
+    strap_clear_error();
+    return diff;
+}
+
+bool strcaseeq(const char *a, const char *b)
+{
+    if (!a || !b)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return false;
+    }
+
+    bool equal = strap_strcasecmp_nul((const unsigned char *)a, (const unsigned char *)b) == 0;
+    strap_clear_error();
+    return equal;
+}
+
+bool strcaseeq_n(const char *a, size_t a_len, const char *b, size_t b_len)
+{
+    if (!a || !b)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return false;
+    }
+
+    bool equal = a_len == b_len &&
+                 strap_ascii_casecmp_prefix((const unsigned char *)a, (const unsigned char *)b, a_len) == a_len;
+    strap_clear_error();
+    return equal;
+}
+
+static uint64_t strap_rotl64(uint64_t value, unsigned shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+uint64_t strap_hash_ci(const char *s, size_t len)
+{
+    if (!s)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const unsigned char *p = (const unsigned char *)s;
+    uint64_t hash = 0x27D4EB2F165667C5ULL ^ ((uint64_t)len * prime1);
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, p + i, sizeof(word));
+        hash ^= strap_rotl64(strap_ascii_fold64(word) * prime2, 31) * prime1;
+        hash = strap_rotl64(hash, 27) * prime1 + prime2;
+    }
+
+    if (i < len)
+    {
+        uint64_t word = 0;
+        memcpy(&word, p + i, len - i);
+        hash ^= strap_rotl64(strap_ascii_fold64(word) * prime2, 31) * prime1;
+        hash = strap_rotl64(hash, 27) * prime1 + prime2;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    strap_clear_error();
+    return hash;
+}
+
+static char **strsplit_limit_impl(strap_slab_t *slab, const char *s, const char *delim, size_t max_splits, size_t *out_count)
+{
+    if (!s || !delim)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    size_t delim_len = strlen(delim);
+    if (delim_len == 0)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    size_t max_tokens = 0;
+    if (max_splits > 0)
+    {
+        if (strap_check_add_overflow(max_splits, 1))
+        {
+            errno = EOVERFLOW;
+            strap_set_error(STRAP_ERR_OVERFLOW);
+            return NULL;
+        }
+        max_tokens = max_splits + 1;
+    }
+
+    size_t capacity = max_tokens > 0 ? max_tokens : 4;
+    if (strap_check_add_overflow(capacity, 1) ||
+        strap_check_mul_overflow(capacity + 1, sizeof(char *)))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
+
+    char **tokens = strap_mem_alloc((capacity + 1) * sizeof(char *));
+    if (!tokens)
+    {
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
+    }
+
+    size_t count = 0;
+    size_t splits = 0;
+    const char *cursor = s;
+
+    for (;;)
+    {
+        if (max_splits > 0 && splits >= max_splits)
+        {
+            char *tail = strap_split_token(slab, cursor, strlen(cursor));
+            if (!tail)
+            {
+                strap_split_free_partial(slab, tokens, count);
+                return NULL;
+            }
+
+            if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
+            {
+                strap_split_free_token(slab, tail);
+                strap_split_free_partial(slab, tokens, count);
+                return NULL;
+            }
+
+            tokens[count++] = tail;
+            break;
+        }
+
+        const char *match = strstr(cursor, delim);
+        if (!match)
+        {
+            char *tail = strap_split_token(slab, cursor, strlen(cursor));
+            if (!tail)
+            {
+                strap_split_free_partial(slab, tokens, count);
+                return NULL;
+            }
+
+            if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
+            {
+                strap_split_free_token(slab, tail);
+                strap_split_free_partial(slab, tokens, count);
+                return NULL;
+            }
+
+            tokens[count++] = tail;
+            break;
+        }
+
+        char *segment = strap_split_token(slab, cursor, (size_t)(match - cursor));
+        if (!segment)
+        {
+            strap_split_free_partial(slab, tokens, count);
+            return NULL;
+        }
+
+        if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
+        {
+            strap_split_free_token(slab, segment);
+            strap_split_free_partial(slab, tokens, count);
+            return NULL;
+        }
+
+        tokens[count++] = segment;
+        cursor = match + delim_len;
+        ++splits;
+    }
+
+    if (strap_split_reserve(&tokens, &capacity, count, max_tokens) != 0)
+    {
+        strap_split_free_partial(slab, tokens, count);
+        return NULL;
+    }
+
+    tokens[count] = NULL;
+    if (out_count)
+        *out_count = count;
+
+    strap_clear_error();
+    return tokens;
+}
+
+char **strsplit_limit(const char *s, const char *delim, size_t max_splits, size_t *out_count)
+{
+    return strsplit_limit_impl(NULL, s, delim, max_splits, out_count);
+}
+
+char **strsplit_limit_slab(strap_slab_t *slab, const char *s, const char *delim, size_t max_splits, size_t *out_count)
+{
+    if (!slab)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strsplit_limit_impl(slab, s, delim, max_splits, out_count);
+}
+
+static char **strsplit_predicate_impl(strap_slab_t *slab,
+                                      const char *s,
+                                      strap_split_predicate_fn predicate,
+                                      void *userdata,
+                                      size_t max_splits,
+                                      size_t *out_count)
+{
+    if (!s || !predicate)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    size_t max_tokens = 0;
+    if (max_splits > 0)
+    {
+        if (strap_check_add_overflow(max_splits, 1))
+        {
+            errno = EOVERFLOW;
+            strap_set_error(STRAP_ERR_OVERFLOW);
+            return NULL;
+        }
+        max_tokens = max_splits + 1;
+    }
+
+    size_t capacity = max_tokens > 0 ? max_tokens : 4;
+    if (strap_check_add_overflow(capacity, 1) ||
+        strap_check_mul_overflow(capacity + 1, sizeof(char *)))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
+
+    char **tokens = strap_mem_alloc((capacity + 1) * sizeof(char *));
+    if (!tokens)
+    {
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
+    }
+
+    size_t count = 0;
+    size_t splits = 0;
+    size_t pos = 0;
+    const unsigned char *buffer = (const unsigned char *)s;
+
+    while (buffer[pos] != '\0')
+    {
+        while (buffer[pos] != '\0' && predicate(buffer[pos], userdata))
+            ++pos;
+        if (buffer[pos] == '\0')
+            break;
+
+        if (max_splits > 0 && splits >= max_splits)
+        {
+            size_t tail_len = strlen((const char *)&buffer[pos]);
+            char *tail = strap_split_token(slab, (const char *)&buffer[pos], tail_len);
+            if (!tail)
+            {
+                strap_split_free_partial(slab, tokens, count);
+                return NULL;
+            }
+
+            if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
+            {
+                strap_split_free_token(slab, tail);
+                strap_split_free_partial(slab, tokens, count);
+                return NULL;
+            }
+
+            tokens[count++] = tail;
+            pos += tail_len;
+            break;
+        }
+
+        size_t start = pos;
+        while (buffer[pos] != '\0' && !predicate(buffer[pos], userdata))
+            ++pos;
+
+        char *token = strap_split_token(slab, (const char *)&buffer[start], pos - start);
+        if (!token)
+        {
+            strap_split_free_partial(slab, tokens, count);
+            return NULL;
+        }
+
+        if (strap_split_reserve(&tokens, &capacity, count + 1, max_tokens) != 0)
+        {
+            strap_split_free_token(slab, token);
+            strap_split_free_partial(slab, tokens, count);
+            return NULL;
+        }
+
+        tokens[count++] = token;
+
+        if (buffer[pos] == '\0')
+            break;
+
+        ++splits;
+    }
+
+    tokens[count] = NULL;
+    if (out_count)
+        *out_count = count;
+
+    strap_clear_error();
+    return tokens;
+}
+
+char **strsplit_predicate(const char *s,
+                          strap_split_predicate_fn predicate,
+                          void *userdata,
+                          size_t max_splits,
+                          size_t *out_count)
+{
+    return strsplit_predicate_impl(NULL, s, predicate, userdata, max_splits, out_count);
+}
+
+char **strsplit_predicate_slab(strap_slab_t *slab,
+                               const char *s,
+                               strap_split_predicate_fn predicate,
+                               void *userdata,
+                               size_t max_splits,
+                               size_t *out_count)
+{
+    if (!slab)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strsplit_predicate_impl(slab, s, predicate, userdata, max_splits, out_count);
+}
+
+void strsplit_free(char **tokens)
+{
+    if (!tokens)
+        return;
+    for (size_t i = 0; tokens[i] != NULL; ++i)
+        strap_free(tokens[i]);
+    strap_free(tokens);
+}
+
+void strsplit_free_slab(strap_slab_t *slab, char **tokens)
+{
+    if (!tokens)
+        return;
+    if (!slab)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return;
+    }
+    for (size_t i = 0; tokens[i] != NULL; ++i)
+        strap_slab_free(slab, tokens[i]);
+    strap_free(tokens);
+}
+
+/* Trim */
+static char *strtrim_impl(strap_arena_t *arena, strap_slab_t *slab, const char *s)
+{
+    if (!s)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    const unsigned char *bytes = (const unsigned char *)s;
+    size_t total_len = strlen(s);
+
+    size_t leading = strap_trim_leading_ascii_simd(bytes, total_len);
+    const unsigned char *start = bytes;
+
+    if (leading == SIZE_MAX)
+    {
+        leading = 0;
+        while (leading < total_len && isspace((unsigned char)start[0]))
+        {
+            ++start;
+            ++leading;
+        }
+    }
+    else
+    {
+        start += leading;
+    }
+
+    size_t remaining_len = total_len - leading;
+    size_t trimmed_len = strap_trim_trailing_ascii_simd(start, remaining_len);
+    size_t len;
+
+    if (trimmed_len == SIZE_MAX)
+    {
+        len = remaining_len;
+        while (len > 0 && isspace((unsigned char)start[len - 1]))
+            --len;
+    }
+    else
+    {
+        len = trimmed_len;
+    }
+
+    if (strap_check_add_overflow(len, 1))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
+
+    char *result;
+    if (arena || slab)
+    {
+        result = arena ? strap_arena_alloc(arena, len + 1) : strap_slab_alloc(slab, len + 1);
+        if (!result)
+            return NULL;
+    }
+    else
+    {
+        result = strap_mem_alloc(len + 1);
+        if (!result)
+        {
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+            return NULL;
+        }
+    }
+
+    if (len > 0)
+        memcpy(result, start, len);
+    result[len] = '\0';
+
+    strap_clear_error();
+    return result;
+}
+
+char *strtrim(const char *s)
+{
+    return strtrim_impl(NULL, NULL, s);
+}
+
+char *strtrim_arena(strap_arena_t *arena, const char *s)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strtrim_impl(arena, NULL, s);
+}
+
+char *strtrim_slab(strap_slab_t *slab, const char *s)
+{
+    if (!slab)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strtrim_impl(NULL, slab, s);
+}
+
+void strtrim_inplace(char *s)
+{
+    if (!s)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return;
+    }
+
+    unsigned char *start = (unsigned char *)s;
+    while (*start && isspace(*start))
+        ++start;
+
+    if ((char *)start != s)
+        memmove(s, start, strlen((const char *)start) + 1);
+
+    size_t len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len - 1]))
+    {
+        s[len - 1] = '\0';
+        --len;
+    }
+
+    strap_clear_error();
+}
+
+bool strstartswith(const char *s, const char *prefix)
+{
+    if (!s || !prefix)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return false;
+    }
+
+    size_t prefix_len = strlen(prefix);
+    bool matches = strncmp(s, prefix, prefix_len) == 0;
+    strap_clear_error();
+    return matches;
+}
+
+bool strendswith(const char *s, const char *suffix)
+{
+    if (!s || !suffix)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return false;
+    }
+
+    size_t s_len = strlen(s);
+    size_t suffix_len = strlen(suffix);
+    if (suffix_len > s_len)
+    {
+        strap_clear_error();
+        return false;
+    }
+
+    bool matches = strncmp(s + (s_len - suffix_len), suffix, suffix_len) == 0;
+    strap_clear_error();
+    return matches;
+}
+
+static char *strreplace_impl(strap_arena_t *arena, const char *s, const char *search, const char *replacement)
+{
+    if (!s || !search)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    if (!replacement)
+        replacement = "";
+
+    size_t search_len = strlen(search);
+    if (search_len == 0)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    size_t replace_len = strlen(replacement);
+    size_t count = 0;
+
+    const char *cursor = s;
+    while ((cursor = strstr(cursor, search)) != NULL)
+    {
+        ++count;
+        cursor += search_len;
+    }
+
+    if (count == 0)
+    {
+        if (arena)
+            return strap_arena_strdup(arena, s);
+
+        char *copy = strap_mem_strdup(s);
+        if (!copy)
+        {
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+        }
+        else
+        {
+            strap_clear_error();
+        }
+        return copy;
+    }
+
+    size_t base_len = strlen(s);
+    size_t total_len = base_len;
+
+    if (replace_len >= search_len)
+    {
+        size_t diff = replace_len - search_len;
+        if (strap_check_mul_overflow(count, diff))
+        {
+            errno = EOVERFLOW;
+            strap_set_error(STRAP_ERR_OVERFLOW);
+            return NULL;
+        }
+        size_t increase = count * diff;
+        if (strap_check_add_overflow(total_len, increase))
+        {
+            errno = EOVERFLOW;
+            strap_set_error(STRAP_ERR_OVERFLOW);
+            return NULL;
+        }
+        total_len += increase;
+    }
+    else
+    {
+        size_t diff = search_len - replace_len;
+        size_t decrease = count * diff;
+        if (decrease > total_len)
+        {
+            errno = EOVERFLOW;
+            strap_set_error(STRAP_ERR_OVERFLOW);
+            return NULL;
+        }
+        total_len -= decrease;
+    }
+
+    if (strap_check_add_overflow(total_len, 1))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
+
+    char *result;
+    if (arena)
+    {
+        result = strap_arena_alloc(arena, total_len + 1);
+        if (!result)
+            return NULL;
+    }
+    else
+    {
+        result = strap_mem_alloc(total_len + 1);
+        if (!result)
+        {
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+            return NULL;
+        }
+    }
+
+    const char *src = s;
+    char *dst = result;
+    const char *match;
+
+    while ((match = strstr(src, search)) != NULL)
+    {
+        size_t segment_len = (size_t)(match - src);
+        memcpy(dst, src, segment_len);
+        dst += segment_len;
+        if (replace_len > 0)
+        {
+            memcpy(dst, replacement, replace_len);
+            dst += replace_len;
+        }
+        src = match + search_len;
+    }
+
+    size_t tail_len = strlen(src);
+    memcpy(dst, src, tail_len);
+    dst += tail_len;
+    *dst = '\0';
+
+    strap_clear_error();
+    return result;
+}
+
+char *strreplace(const char *s, const char *search, const char *replacement)
+{
+    return strreplace_impl(NULL, s, search, replacement);
+}
+
+char *strreplace_arena(strap_arena_t *arena, const char *s, const char *search, const char *replacement)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strreplace_impl(arena, s, search, replacement);
+}
+
+/* Locale handles */
+strap_locale_t *strap_locale_open(const char *locale_name)
+{
+    strap_locale_t *locale = strap_mem_alloc(sizeof(*locale));
+    if (!locale)
+    {
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
+    }
+
+    if (strap_locale_init(locale, locale_name) != 0)
+    {
+        strap_free(locale);
+        return NULL;
+    }
+
+    strap_clear_error();
+    return locale;
+}
+
+void strap_locale_close(strap_locale_t *locale)
+{
+    if (!locale)
+        return;
+
+    strap_locale_release(locale);
+    strap_free(locale);
+}
+
+static char *strap_locale_case_impl(strap_arena_t *arena, const char *s, const strap_locale_t *locale, int make_upper)
+{
+    if (!s || !locale)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    size_t len = strlen(s);
+    if (strap_check_add_overflow(len, 1))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
+
+    char *buffer;
+    if (arena)
+    {
+        buffer = strap_arena_alloc(arena, len + 1);
+        if (!buffer)
+            return NULL;
+    }
+    else
+    {
+        buffer = strap_mem_alloc(len + 1);
+        if (!buffer)
+        {
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+            return NULL;
+        }
+    }
+
+    if (locale->kind == STRAP_LOCALE_NONE)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            unsigned char ch = (unsigned char)s[i];
+            buffer[i] = (char)(make_upper ? toupper(ch) : tolower(ch));
+        }
+    }
+    else
+    {
+        strap_case_map_bytes((unsigned char *)buffer, (const unsigned char *)s, len,
+                             make_upper ? locale->upper : locale->lower,
+                             make_upper ? locale->ascii_upper : locale->ascii_lower,
+                             make_upper);
+    }
+    buffer[len] = '\0';
+
+    strap_clear_error();
+    return buffer;
+}
+
+static char *strap_locale_case_named(strap_arena_t *arena, const char *s, const char *locale_name, int make_upper)
+{
+    if (!s)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    strap_locale_t scratch;
+    const strap_locale_t *locale = strap_locale_lookup(locale_name, &scratch);
+    if (!locale)
+        return NULL;
+
+    char *result = strap_locale_case_impl(arena, s, locale, make_upper);
+    strap_locale_lookup_done(locale, &scratch);
+    return result;
+}
+
+char *strtolower_locale(const char *s, const char *locale_name)
+{
+    return strap_locale_case_named(NULL, s, locale_name, 0);
+}
+
+char *strtolower_locale_arena(strap_arena_t *arena, const char *s, const char *locale_name)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strap_locale_case_named(arena, s, locale_name, 0);
+}
+
+char *strtoupper_locale(const char *s, const char *locale_name)
+{
+    return strap_locale_case_named(NULL, s, locale_name, 1);
+}
+
+char *strtoupper_locale_arena(strap_arena_t *arena, const char *s, const char *locale_name)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strap_locale_case_named(arena, s, locale_name, 1);
+}
+
+char *strtolower_locale_handle(const char *s, const strap_locale_t *locale)
+{
+    return strap_locale_case_impl(NULL, s, locale, 0);
+}
+
+char *strtoupper_locale_handle(const char *s, const strap_locale_t *locale)
+{
+    return strap_locale_case_impl(NULL, s, locale, 1);
+}
+
+char *strtolower_locale_handle_arena(strap_arena_t *arena, const char *s, const strap_locale_t *locale)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strap_locale_case_impl(arena, s, locale, 0);
+}
+
+char *strtoupper_locale_handle_arena(strap_arena_t *arena, const char *s, const strap_locale_t *locale)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strap_locale_case_impl(arena, s, locale, 1);
+}
+
+int strcoll_locale_handle(const char *a, const char *b, const strap_locale_t *locale)
+{
+    if (!a || !b || !locale)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    strap_locale_ctx ctx;
+    if (strap_locale_enter(locale, &ctx) != 0)
+        return 0;
+
+    int cmp;
+    if (ctx.kind == STRAP_LOCALE_HANDLE)
+    {
+#if defined(_WIN32)
+        cmp = _strcoll_l(a, b, ctx.handle);
+#else
+        cmp = strcoll_l(a, b, ctx.handle);
+#endif
+    }
+    else
+    {
+        cmp = strcoll(a, b);
+    }
+
+    strap_locale_exit(&ctx);
+    strap_clear_error();
+    return cmp;
+}
+
+int strcasecmp_locale_handle(const char *a, const char *b, const strap_locale_t *locale)
+{
+    if (!a || !b || !locale)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    const unsigned char *pa = (const unsigned char *)a;
+    const unsigned char *pb = (const unsigned char *)b;
+    int diff;
+
+    if (locale->kind == STRAP_LOCALE_NONE)
+    {
+        while (*pa && *pb && tolower(*pa) == tolower(*pb))
+        {
+            ++pa;
+            ++pb;
+        }
+        diff = tolower(*pa) - tolower(*pb);
+    }
+    else
+    {
+        const unsigned char *map = locale->lower;
+        while (*pa && *pb && map[*pa] == map[*pb])
+        {
+            ++pa;
+            ++pb;
+        }
+        diff = (int)map[*pa] - (int)map[*pb];
+    }
+
+    strap_clear_error();
+    return diff;
+}
+
+int strcoll_locale(const char *a, const char *b, const char *locale_name)
+{
+    if (!a || !b)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    strap_locale_t scratch;
+    const strap_locale_t *locale = strap_locale_lookup(locale_name, &scratch);
+    if (!locale)
+        return 0;
+
+    int cmp = strcoll_locale_handle(a, b, locale);
+    strap_locale_lookup_done(locale, &scratch);
+    return cmp;
+}
+
+int strcasecmp_locale(const char *a, const char *b, const char *locale_name)
+{
+    if (!a || !b)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    strap_locale_t scratch;
+    const strap_locale_t *locale = strap_locale_lookup(locale_name, &scratch);
+    if (!locale)
+        return 0;
+
+    int diff = strcasecmp_locale_handle(a, b, locale);
+    strap_locale_lookup_done(locale, &scratch);
+    return diff;
+}
+
+/* Collation keys */
+/* Returns the key length, or SIZE_MAX when the input cannot be
+ * transformed: POSIX reports that through errno only, the Windows CRT by
+ * returning INT_MAX. */
+static size_t strap_strxfrm_ctx(char *dst, const char *src, size_t n, const strap_locale_ctx *ctx)
+{
+    size_t needed;
+    errno = 0;
+    if (ctx->kind == STRAP_LOCALE_HANDLE)
+    {
+#if defined(_WIN32)
+        needed = _strxfrm_l(dst, src, n, ctx->handle);
+#else
+        needed = strxfrm_l(dst, src, n, ctx->handle);
+#endif
+    }
+    else
+    {
+        needed = strxfrm(dst, src, n);
+    }
+
+#if defined(_WIN32)
+    if (needed == (size_t)INT_MAX)
+        return SIZE_MAX;
+#endif
+    return errno != 0 ? SIZE_MAX : needed;
+}
+
+/* Transforms `s` once into a small stack buffer and copies the key into the
+ * arena; only keys that do not fit are transformed a second time. */
+static char *strap_collate_key_ctx(strap_arena_t *arena, const char *s, const strap_locale_ctx *ctx, size_t *out_len)
+{
+    char scratch[256];
+    size_t needed = strap_strxfrm_ctx(scratch, s, sizeof(scratch), ctx);
+    if (needed == SIZE_MAX)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    char *key = strap_arena_alloc(arena, needed + 1);
+    if (!key)
+        return NULL;
+
+    if (needed < sizeof(scratch))
+    {
+        memcpy(key, scratch, needed + 1);
+    }
+    else if (strap_strxfrm_ctx(key, s, needed + 1, ctx) != needed)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    if (out_len)
+        *out_len = needed;
+    return key;
+}
+
+char *strap_collate_key_handle(strap_arena_t *arena, const char *s, const strap_locale_t *locale, size_t *out_len)
+{
+    if (!arena || !s || !locale)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    strap_locale_ctx ctx;
+    if (strap_locale_enter(locale, &ctx) != 0)
+        return NULL;
+
+    char *key = strap_collate_key_ctx(arena, s, &ctx, out_len);
+    strap_locale_exit(&ctx);
+    if (key)
+        strap_clear_error();
+    return key;
+}
+
+char *strap_collate_key(strap_arena_t *arena, const char *s, const char *locale_name, size_t *out_len)
+{
+    if (!arena || !s)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    strap_locale_t scratch;
+    const strap_locale_t *locale = strap_locale_lookup(locale_name, &scratch);
+    if (!locale)
+        return NULL;
+
+    char *key = strap_collate_key_handle(arena, s, locale, out_len);
+    strap_locale_lookup_done(locale, &scratch);
+    return key;
+}
+
+typedef struct
+{
+    const char *key;
+    size_t key_len;
+    char *str;
+} strap_sort_entry_t;
+
+static int strap_sort_entry_cmp(const void *lhs, const void *rhs)
+{
+    const strap_sort_entry_t *a = lhs;
+    const strap_sort_entry_t *b = rhs;
+    size_t n = a->key_len < b->key_len ? a->key_len : b->key_len;
+    int cmp = memcmp(a->key, b->key, n);
+    if (cmp != 0)
+        return cmp;
+    if (a->key_len != b->key_len)
+        return a->key_len < b->key_len ? -1 : 1;
+    return 0;
+}
+
+int strap_sort_locale_handle(char **strs, size_t n, const strap_locale_t *locale)
+{
+    if ((!strs && n > 0) || !locale)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (!strs[i])
+        {
+            errno = EINVAL;
+            strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+            return -1;
+        }
+    }
+
+    if (n < 2)
+    {
+        strap_clear_error();
+        return 0;
+    }
+
+    if (strap_check_mul_overflow(n, sizeof(strap_sort_entry_t)))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    strap_arena_t *arena = strap_arena_create(64 * 1024);
+    if (!arena)
+        return -1;
+
+    strap_sort_entry_t *entries = strap_arena_alloc(arena, n * sizeof(strap_sort_entry_t));
+    if (!entries)
+    {
+        strap_arena_destroy(arena);
+        return -1;
+    }
+
+    strap_locale_ctx ctx;
+    if (strap_locale_enter(locale, &ctx) != 0)
+    {
+        strap_arena_destroy(arena);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        entries[i].str = strs[i];
+        entries[i].key = strap_collate_key_ctx(arena, strs[i], &ctx, &entries[i].key_len);
+        if (!entries[i].key)
+        {
+            strap_locale_exit(&ctx);
+            strap_arena_destroy(arena);
+            return -1;
+        }
+    }
+    strap_locale_exit(&ctx);
+
+    qsort(entries, n, sizeof(strap_sort_entry_t), strap_sort_entry_cmp);
+    for (size_t i = 0; i < n; ++i)
+        strs[i] = entries[i].str;
+
+    strap_arena_destroy(arena);
+    strap_clear_error();
+    return 0;
+}
+
+int strap_sort_locale(char **strs, size_t n, const char *locale_name)
+{
+    strap_locale_t scratch;
+    const strap_locale_t *locale = strap_locale_lookup(locale_name, &scratch);
+    if (!locale)
+        return -1;
+
+    int rc = strap_sort_locale_handle(strs, n, locale);
+    strap_locale_lookup_done(locale, &scratch);
+    return rc;
+}
+
+/* --------------------------------------------------------------------- */
+/* UTF-8 case mapping                                                     */
+
+typedef enum
+{
+    STRAP_UTF8_LOWER,
+    STRAP_UTF8_UPPER,
+    STRAP_UTF8_FOLD
+} strap_utf8_case_t;
+
+static uint32_t strap_case_lookup(const strap_case_range_t *ranges, size_t count, uint32_t cp)
+{
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ranges[mid].start <= cp)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0)
+        return cp;
+
+    const strap_case_range_t *range = &ranges[lo - 1];
+    uint32_t offset = cp - range->start;
+    if (offset % range->stride != 0 || offset / range->stride >= range->count)
+        return cp;
+    return (uint32_t)((int32_t)cp + range->delta);
+}
+
+static uint32_t strap_utf8_map_codepoint(uint32_t cp, strap_utf8_case_t mode)
+{
+    switch (mode)
+    {
+    case STRAP_UTF8_UPPER:
+        return strap_case_lookup(strap_case_upper_ranges,
+                                 sizeof(strap_case_upper_ranges) / sizeof(strap_case_upper_ranges[0]), cp);
+    case STRAP_UTF8_LOWER:
+        return strap_case_lookup(strap_case_lower_ranges,
+                                 sizeof(strap_case_lower_ranges) / sizeof(strap_case_lower_ranges[0]), cp);
+    case STRAP_UTF8_FOLD:
+    default:
+        return strap_case_lookup(strap_case_fold_ranges,
+                                 sizeof(strap_case_fold_ranges) / sizeof(strap_case_fold_ranges[0]), cp);
+    }
+}
+
+/* Decodes one well-formed UTF-8 sequence and returns its length, or 0 for
+ * malformed input (overlong forms, surrogates, truncation). */
+static size_t strap_utf8_decode(const unsigned char *s, size_t len, uint32_t *out)
+{
+    unsigned char c = s[0];
+
+    if (c >= 0xC2 && c <= 0xDF)
+    {
+        if (len < 2 || (s[1] & 0xC0) != 0x80)
+            return 0;
+        *out = ((uint32_t)(c & 0x1F) << 6) | (uint32_t)(s[1] & 0x3F);
+        return 2;
+    }
+
+    if (c >= 0xE0 && c <= 0xEF)
+    {
+        if (len < 3 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80)
+            return 0;
+        uint32_t cp = ((uint32_t)(c & 0x0F) << 12) | ((uint32_t)(s[1] & 0x3F) << 6) | (uint32_t)(s[2] & 0x3F);
+        if (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))
+            return 0;
+        *out = cp;
+        return 3;
+    }
+
+    if (c >= 0xF0 && c <= 0xF4)
+    {
+        if (len < 4 || (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 || (s[3] & 0xC0) != 0x80)
+            return 0;
+        uint32_t cp = ((uint32_t)(c & 0x07) << 18) | ((uint32_t)(s[1] & 0x3F) << 12) |
+                      ((uint32_t)(s[2] & 0x3F) << 6) | (uint32_t)(s[3] & 0x3F);
+        if (cp < 0x10000 || cp > 0x10FFFF)
+            return 0;
+        *out = cp;
+        return 4;
+    }
+
+    return 0;
+}
+
+/* Writes `cp` to `dst` when non-NULL and returns the encoded length. */
+static size_t strap_utf8_encode(uint32_t cp, unsigned char *dst)
+{
+    if (cp < 0x80)
+    {
+        if (dst)
+            dst[0] = (unsigned char)cp;
+        return 1;
+    }
+    if (cp < 0x800)
+    {
+        if (dst)
+        {
+            dst[0] = (unsigned char)(0xC0 | (cp >> 6));
+            dst[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        }
+        return 2;
+    }
+    if (cp < 0x10000)
+    {
+        if (dst)
+        {
+            dst[0] = (unsigned char)(0xE0 | (cp >> 12));
+            dst[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+            dst[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        }
+        return 3;
+    }
+    if (dst)
+    {
+        dst[0] = (unsigned char)(0xF0 | (cp >> 18));
+        dst[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+        dst[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        dst[3] = (unsigned char)(0x80 | (cp & 0x3F));
+    }
+    return 4;
+}
+
+static size_t strap_ascii_prefix_len(const unsigned char *s, size_t len)
+{
+    size_t i = 0;
+#if STRAP_HAVE_SSE2
+    for (; i + 16 <= len; i += 16)
+    {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+        if (mask)
+            return i + strap_ctz16(mask);
+    }
+#endif
+    while (i < len && s[i] < 0x80)
+        ++i;
+    return i;
+}
+
+/* Converts `src` and returns the output length. With `dst == NULL` only the
+ * length is computed. Pure-ASCII 16-byte runs are converted with a vector
+ * range compare; other bytes are decoded one scalar value at a time, and
+ * malformed sequences are copied through unchanged. */
+static size_t strap_utf8_case_convert(unsigned char *dst, const unsigned char *src, size_t len, strap_utf8_case_t mode)
+{
+    const unsigned char first = mode == STRAP_UTF8_UPPER ? 'a' : 'A';
+    size_t i = 0;
+    size_t out = 0;
+#if STRAP_HAVE_SSE2
+    size_t scalar_end = 0;
+#endif
+
+    while (i < len)
+    {
+#if STRAP_HAVE_SSE2
+        if (i >= scalar_end && i + 16 <= len)
+        {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(src + i));
+            if (_mm_movemask_epi8(chunk) == 0)
+            {
+                if (dst)
+                    _mm_storeu_si128((__m128i *)(dst + out), strap_ascii_flip_case16(chunk, (char)first));
+                i += 16;
+                out += 16;
+                continue;
+            }
+            scalar_end = i + 16;
+        }
+#endif
+
+        unsigned char c = src[i];
+        if (c < 0x80)
+        {
+            if (dst)
+                dst[out] = (c >= first && c < first + 26) ? (unsigned char)(c ^ 0x20) : c;
+            ++out;
+            ++i;
+            continue;
+        }
+
+        uint32_t cp;
+        size_t consumed = strap_utf8_decode(src + i, len - i, &cp);
+        if (consumed == 0)
+        {
+            if (dst)
+                dst[out] = c;
+            ++out;
+            ++i;
+            continue;
+        }
+
+        out += strap_utf8_encode(strap_utf8_map_codepoint(cp, mode), dst ? dst + out : NULL);
+        i += consumed;
+    }
+
+    return out;
+}
+
+static char *strap_utf8_case_impl(strap_arena_t *arena, const char *s, strap_utf8_case_t mode)
+{
+    if (!s)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    const unsigned char *src = (const unsigned char *)s;
+    size_t len = strlen(s);
+    size_t out_len = strap_ascii_prefix_len(src, len);
+    if (out_len < len)
+        out_len += strap_utf8_case_convert(NULL, src + out_len, len - out_len, mode);
+
+    if (strap_check_add_overflow(out_len, 1))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
+
+    unsigned char *buffer;
+    if (arena)
+    {
+        buffer = strap_arena_alloc(arena, out_len + 1);
+        if (!buffer)
+            return NULL;
+    }
+    else
+    {
+        buffer = strap_mem_alloc(out_len + 1);
+        if (!buffer)
+        {
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
+            return NULL;
+        }
+    }
+
+    strap_utf8_case_convert(buffer, src, len, mode);
+    buffer[out_len] = '\0';
+
+    strap_clear_error();
+    return (char *)buffer;
+}
+
+char *strap_utf8_casefold(const char *s)
+{
+    return strap_utf8_case_impl(NULL, s, STRAP_UTF8_FOLD);
+}
+
+char *strap_utf8_tolower(const char *s)
+{
+    return strap_utf8_case_impl(NULL, s, STRAP_UTF8_LOWER);
+}
+
+char *strap_utf8_toupper(const char *s)
+{
+    return strap_utf8_case_impl(NULL, s, STRAP_UTF8_UPPER);
+}
+
+char *strap_utf8_casefold_arena(strap_arena_t *arena, const char *s)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strap_utf8_case_impl(arena, s, STRAP_UTF8_FOLD);
+}
+
+char *strap_utf8_tolower_arena(strap_arena_t *arena, const char *s)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strap_utf8_case_impl(arena, s, STRAP_UTF8_LOWER);
+}
+
+char *strap_utf8_toupper_arena(strap_arena_t *arena, const char *s)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return strap_utf8_case_impl(arena, s, STRAP_UTF8_UPPER);
+}
+
+/* --------------------------------------------------------------------- */
+/* Time helpers                                                           */
+
+static int strap_gmtime_safe(time_t value, struct tm *out)
+{
+    if (!out)
+        return -1;
+
+#if defined(_WIN32)
+    return gmtime_s(out, &value) == 0 ? 0 : -1;
+#elif defined(_POSIX_THREAD_SAFE_FUNCTIONS) || defined(__unix__) || defined(__APPLE__)
+    return gmtime_r(&value, out) ? 0 : -1;
+#else
+    struct tm *tmp = gmtime(&value);
+    if (!tmp)
+        return -1;
+    *out = *tmp;
+    return 0;
+#endif
+}
+
+static int strap_localtime_safe(time_t value, struct tm *out)
+{
+    if (!out)
+        return -1;
+
+#if defined(_WIN32)
+    return localtime_s(out, &value) == 0 ? 0 : -1;
+#elif defined(_POSIX_THREAD_SAFE_FUNCTIONS) || defined(__unix__) || defined(__APPLE__)
+    return localtime_r(&value, out) ? 0 : -1;
+#else
+    struct tm *tmp = localtime(&value);
+    if (!tmp)
+        return -1;
+    *out = *tmp;
+    return 0;
+#endif
+}
+
+static int strap_is_leap(int year)
+{
+    return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+}
+
+static int strap_days_in_month(int year, unsigned month)
+{
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12)
+        return 0;
+    if (month == 2 && strap_is_leap(year))
+        return 29;
+    return days[month - 1];
+}
+
+static int64_t strap_days_from_civil(int year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = (unsigned)(year - era * 400);
+    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+/* Inverse of strap_days_from_civil. */
+static void strap_civil_from_days(int64_t days, int64_t *year, unsigned *month, unsigned *day)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = (unsigned)(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = (int64_t)yoe + era * 400 + (*month <= 2);
+}
+
+static const char strap_two_digits[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static char *strap_write_2digits(char *dst, unsigned value)
+{
+    memcpy(dst, &strap_two_digits[value * 2], 2);
+    return dst + 2;
+}
+
+/* Writes `YYYY-MM-DDTHH:MM:SS` (19 bytes) for a year in [0, 9999]. */
+static char *strap_write_datetime(char *dst, unsigned year, unsigned month, unsigned day, unsigned day_seconds)
+{
+    dst = strap_write_2digits(dst, year / 100);
+    dst = strap_write_2digits(dst, year % 100);
+    *dst++ = '-';
+    dst = strap_write_2digits(dst, month);
+    *dst++ = '-';
+    dst = strap_write_2digits(dst, day);
+    *dst++ = 'T';
+    dst = strap_write_2digits(dst, day_seconds / 3600);
+    *dst++ = ':';
+    dst = strap_write_2digits(dst, day_seconds / 60 % 60);
+    *dst++ = ':';
+    return strap_write_2digits(dst, day_seconds % 60);
+}
+
+/* Writes `.ffffff` (7 bytes) for `micro` in [0, 999999]. */
+static char *strap_write_micros(char *dst, unsigned micro)
+{
+    *dst++ = '.';
+    dst = strap_write_2digits(dst, micro / 10000);
+    dst = strap_write_2digits(dst, micro / 100 % 100);
+    return strap_write_2digits(dst, micro % 100);
+}
+
+static bool strap_offset_valid(int offset_minutes)
+{
+    return offset_minutes >= -14 * 60 && offset_minutes <= 14 * 60;
+}
+
+/* Writes `Z` or `±HH:MM` for an offset accepted by strap_offset_valid. */
+static char *strap_write_offset(char *dst, int offset_minutes)
+{
+    if (offset_minutes == 0)
+    {
+        *dst++ = 'Z';
+        return dst;
+    }
+
+    unsigned total = (unsigned)(offset_minutes < 0 ? -offset_minutes : offset_minutes);
+    *dst++ = offset_minutes < 0 ? '-' : '+';
+    dst = strap_write_2digits(dst, total / 60);
+    *dst++ = ':';
+    return strap_write_2digits(dst, total % 60);
+}
+
+static int strap_apply_offset(int64_t base, int offset_minutes, int64_t *out_seconds)
+{
+    int64_t delta = (int64_t)offset_minutes * 60;
+    if ((delta > 0 && base > INT64_MAX - delta) || (delta < 0 && base < INT64_MIN - delta))
+        return -1;
+    *out_seconds = base + delta;
+    return 0;
+}
+
+static bool strap_is_digit(char c)
+{
+    return (unsigned char)(c - '0') <= 9;
+}
+
+/* Parses `Z`, `±HH`, `±HHMM` or `±HH:MM` occupying exactly `len` bytes. */
+static strap_error_t strap_tz_offset_parse_core(const char *s, size_t len, int *offset_minutes)
+{
+    if (len == 1 && (s[0] == 'Z' || s[0] == 'z'))
+    {
+        *offset_minutes = 0;
+        return STRAP_OK;
+    }
+
+    if (len < 3 || (s[0] != '+' && s[0] != '-') || !strap_is_digit(s[1]) || !strap_is_digit(s[2]))
+        return STRAP_ERR_INVALID_ARGUMENT;
+
+    int sign = s[0] == '-' ? -1 : 1;
+    int hours = (s[1] - '0') * 10 + (s[2] - '0');
+    int minutes = 0;
+    size_t pos = 3;
+    if (pos < len && s[pos] == ':')
+    {
+        if (len - pos < 3 || !strap_is_digit(s[pos + 1]) || !strap_is_digit(s[pos + 2]))
+            return STRAP_ERR_INVALID_ARGUMENT;
+        minutes = (s[pos + 1] - '0') * 10 + (s[pos + 2] - '0');
+        pos += 3;
+    }
+    else if (len - pos >= 2 && strap_is_digit(s[pos]) && strap_is_digit(s[pos + 1]))
+    {
+        minutes = (s[pos] - '0') * 10 + (s[pos + 1] - '0');
+        pos += 2;
+    }
+
+    if (pos != len)
+        return STRAP_ERR_INVALID_ARGUMENT;
+    if (hours > 14 || minutes >= 60 || (hours == 14 && minutes != 0))
+        return STRAP_ERR_INVALID_ARGUMENT;
+
+    *offset_minutes = sign * (hours * 60 + minutes);
+    return STRAP_OK;
+}
+
+/* `YYYY-MM-DDTHH:MM:SS.ffffff+HH:MM` */
+#define STRAP_ISO8601_MAX_LEN 32
+/* `YYYY-MM-DDTHH:MM:SS.fffffffff+HH:MM` */
+#define STRAP_ISO8601_NS_MAX_LEN 35
+
+static uint64_t strap_load_le64(const char *p)
+{
+    const unsigned char *bytes = (const unsigned char *)p;
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i)
+        value = (value << 8) | bytes[i];
+    return value;
+#else
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+#endif
+}
+
+/* Checks that the bytes selected by `digit_mask` are ASCII digits and the
+ * rest equal `literal`, then returns the digit values with every other
+ * byte cleared. Returns UINT64_MAX on mismatch. */
+static uint64_t strap_swar_digits(uint64_t word, uint64_t digit_mask, uint64_t literal)
+{
+    if ((word & ~digit_mask) != literal)
+        return UINT64_MAX;
+
+    uint64_t digits = word & digit_mask;
+    if ((digits & (0xF0F0F0F0F0F0F0F0ULL & digit_mask)) != (0x3030303030303030ULL & digit_mask))
+        return UINT64_MAX;
+
+    uint64_t values = digits & 0x0F0F0F0F0F0F0F0FULL;
+    if (((values + (0x0606060606060606ULL & digit_mask)) & 0xF0F0F0F0F0F0F0F0ULL) != 0)
+        return UINT64_MAX;
+    return values;
+}
+
+/* Byte i of the result is 10 * digit[i] + digit[i + 1]. */
+static uint64_t strap_swar_pairs(uint64_t values)
+{
+    return values * 10 + (values >> 8);
+}
+
+static unsigned strap_swar_byte(uint64_t word, unsigned index)
+{
+    return (unsigned)((word >> (index * 8)) & 0xFF);
+}
+
+/* Last date converted by a batch parse. Timestamp columns tend to repeat
+ * the same day, so the calendar check and day count are reused while the
+ * `YYYY-MM-DD` bytes match. */
+struct strap_iso8601_day_memo
+{
+    bool valid;
+    uint64_t date_word;
+    uint16_t day_bytes;
+    int64_t days;
+};
+
+/* Parses `YYYY-MM-DD[Tt ]HH:MM:SS[(.|,)f{1,n}](Z|±HH[[:]MM])` occupying
+ * exactly `len` bytes into UTC seconds, the fraction as an integer with
+ * `fraction_digits` (6 or 9) digits and the offset in minutes. The
+ * fixed-layout prefix is validated and converted as three overlapping
+ * 8-byte words. Reports failures through the return value only, leaving
+ * errno and the thread error state to the caller. `memo` may be NULL. */
+static strap_error_t strap_iso8601_parse_core(const char *s,
+                                              size_t len,
+                                              struct strap_iso8601_day_memo *memo,
+                                              int fraction_digits,
+                                              int64_t *out_seconds,
+                                              int32_t *out_fraction,
+                                              int *out_offset)
+{
+    /* The offset is mandatory, so at least one byte follows the seconds. */
+    if (len < 20)
+        return STRAP_ERR_INVALID_ARGUMENT;
+
+    /* "YYYY-MM-" */
+    uint64_t date_word = strap_load_le64(s);
+    uint64_t date = strap_swar_digits(date_word, 0x00FFFF00FFFFFFFFULL, 0x2D00002D00000000ULL);
+    /* "DDTHH:MM", with the date/time separator checked below */
+    uint64_t day_time = strap_swar_digits(strap_load_le64(s + 8), 0xFFFF00FFFF00FFFFULL,
+                                          0x00003A0000000000ULL | ((uint64_t)(unsigned char)s[10] << 16));
+    /* "HH:MM:SS" */
+    uint64_t clock = strap_swar_digits(strap_load_le64(s + 11), 0xFFFF00FFFF00FFFFULL, 0x00003A00003A0000ULL);
+    if (date == UINT64_MAX || day_time == UINT64_MAX || clock == UINT64_MAX)
+        return STRAP_ERR_INVALID_ARGUMENT;
+    if (s[10] != 'T' && s[10] != 't' && s[10] != ' ')
+        return STRAP_ERR_INVALID_ARGUMENT;
+
+    date = strap_swar_pairs(date);
+    day_time = strap_swar_pairs(day_time);
+    clock = strap_swar_pairs(clock);
+
+    int year = (int)(strap_swar_byte(date, 0) * 100 + strap_swar_byte(date, 2));
+    unsigned month = strap_swar_byte(date, 5);
+    unsigned day = strap_swar_byte(day_time, 0);
+    unsigned hour = strap_swar_byte(day_time, 3);
+    unsigned minute = strap_swar_byte(day_time, 6);
+    unsigned second = strap_swar_byte(clock, 6);
+
+    if (hour > 23 || minute > 59 || second > 60)
+        return STRAP_ERR_INVALID_ARGUMENT;
+
+    uint16_t day_bytes;
+    memcpy(&day_bytes, s + 8, sizeof(day_bytes));
+    int64_t days;
+    if (memo && memo->valid && memo->date_word == date_word && memo->day_bytes == day_bytes)
+        days = memo->days;
+    else
+    {
+        int dim = strap_days_in_month(year, month);
+        if (dim == 0 || day == 0 || day > (unsigned)dim)
+            return STRAP_ERR_INVALID_ARGUMENT;
+        days = strap_days_from_civil(year, month, day);
+        if (memo)
+        {
+            memo->valid = true;
+            memo->date_word = date_word;
+            memo->day_bytes = day_bytes;
+            memo->days = days;
+        }
+    }
+
+    size_t pos = 19;
+    int32_t fraction_value = 0;
+    /* ".ffffff" followed by the offset, checked as one word when it fits */
+    uint64_t fraction = UINT64_MAX;
+    if ((s[pos] == '.' || s[pos] == ',') && len >= pos + 8 && !strap_is_digit(s[pos + 7]))
+        fraction = strap_swar_digits(strap_load_le64(s + pos), 0x00FFFFFFFFFFFF00ULL,
+                                     strap_load_le64(s + pos) & 0xFF000000000000FFULL);
+    if (fraction != UINT64_MAX)
+    {
+        fraction = strap_swar_pairs(fraction);
+        fraction_value = (int32_t)(strap_swar_byte(fraction, 1) * 10000 + strap_swar_byte(fraction, 3) * 100 +
+                                   strap_swar_byte(fraction, 5));
+        for (int digits = 6; digits < fraction_digits; ++digits)
+            fraction_value *= 10;
+        pos += 7;
+    }
+    else if (s[pos] == '.' || s[pos] == ',')
+    {
+        ++pos;
+        int digits = 0;
+        while (pos < len && strap_is_digit(s[pos]) && digits < fraction_digits)
+        {
+            fraction_value = fraction_value * 10 + (s[pos] - '0');
+            ++pos;
+            ++digits;
+        }
+        if (digits == 0 || (pos < len && strap_is_digit(s[pos])))
+            return STRAP_ERR_INVALID_ARGUMENT;
+        while (digits++ < fraction_digits)
+            fraction_value *= 10;
+    }
+
+    if (pos == len)
+        return STRAP_ERR_INVALID_ARGUMENT;
+
+    int offset;
+    strap_error_t status = strap_tz_offset_parse_core(s + pos, len - pos, &offset);
+    if (status != STRAP_OK)
+        return status;
+
+    int64_t local_seconds = days * 86400 +
+                            (int64_t)hour * 3600 + (int64_t)minute * 60 + (int64_t)second;
+    if (strap_apply_offset(local_seconds, -offset, out_seconds) != 0)
+        return STRAP_ERR_OVERFLOW;
+
+    *out_fraction = fraction_value;
+    *out_offset = offset;
+    return STRAP_OK;
+}
+
+/* --------------------------------------------------------------------- */
+/* Time zone tables                                                       */
+
+/* A transition date from a POSIX TZ rule: `Mm.w.d`, `Jn` or `n`, followed
+ * by an optional `/time`. */
+struct strap_tz_rule_date
+{
+    char kind;    /* 'M', 'J' (Feb 29 never counted) or 'D' (zero-based) */
+    int month;
+    int week;     /* 1..5, where 5 means the last such weekday */
+    int day;      /* weekday for 'M', zero-based day of year otherwise */
+    int32_t time; /* seconds after local midnight, may exceed a day */
+};
+
+/* UTC offsets of a zone, built from a TZif file or a POSIX TZ string.
+ * Tables are immutable once built so lookups need no locking. */
+struct strap_tz
+{
+    size_t count;
+    int64_t *transitions; /* UTC seconds, ascending */
+    int32_t *offsets;     /* offset in effect from transitions[i] */
+    int32_t initial_offset;
+    bool has_rule;        /* footer rule applies past the last transition */
+    bool rule_has_dst;
+    int32_t std_offset;
+    int32_t dst_offset;
+    struct strap_tz_rule_date start;
+    struct strap_tz_rule_date end;
+    char *name;            /* set for zones from strap_tz_load() */
+    struct strap_tz *next; /* retired local tables or the named cache */
+};
+
+#define STRAP_TZIF_MAX_SIZE (1u << 20)
+
+static uint32_t strap_load_be32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static int64_t strap_load_be64(const unsigned char *p)
+{
+    return (int64_t)(((uint64_t)strap_load_be32(p) << 32) | strap_load_be32(p + 4));
+}
+
+static int64_t strap_floor_div(int64_t value, int64_t divisor)
+{
+    int64_t quotient = value / divisor;
+    if ((value % divisor) != 0 && (value < 0) != (divisor < 0))
+        --quotient;
+    return quotient;
+}
+
+/* The transition arrays share the allocation with the table. */
+static struct strap_tz *strap_tz_alloc(size_t count)
+{
+    const size_t header = (sizeof(struct strap_tz) + sizeof(int64_t) - 1) & ~(sizeof(int64_t) - 1);
+    if (count > (SIZE_MAX - header) / (sizeof(int64_t) + sizeof(int32_t)))
+        return NULL;
+
+    unsigned char *memory = strap_mem_alloc(header + count * (sizeof(int64_t) + sizeof(int32_t)));
+    if (!memory)
+        return NULL;
+
+    struct strap_tz *tz = (struct strap_tz *)memory;
+    memset(tz, 0, sizeof(*tz));
+    tz->count = count;
+    tz->transitions = (int64_t *)(memory + header);
+    tz->offsets = (int32_t *)(memory + header + count * sizeof(int64_t));
+    return tz;
+}
+
+static const char *strap_tz_posix_number(const char *p, int max, int *out)
+{
+    if (!strap_is_digit(*p))
+        return NULL;
+
+    int value = 0;
+    while (strap_is_digit(*p))
+    {
+        value = value * 10 + (*p++ - '0');
+        if (value > max)
+            return NULL;
+    }
+    *out = value;
+    return p;
+}
+
+/* `NAME` of at least three letters or a quoted `<...>` name. */
+static const char *strap_tz_posix_name(const char *p)
+{
+    const char *start = p;
+    if (*p == '<')
+    {
+        while (*++p != '>')
+        {
+            if (*p == '\0')
+                return NULL;
+        }
+        return p - start >= 4 ? p + 1 : NULL;
+    }
+
+    while ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))
+        ++p;
+    return p - start >= 3 ? p : NULL;
+}
+
+/* `[+-]hh[:mm[:ss]]` in seconds; hours go up to 167 as in RFC 8536. */
+static const char *strap_tz_posix_time(const char *p, int32_t *out)
+{
+    int sign = 1;
+    if (*p == '+' || *p == '-')
+        sign = *p++ == '-' ? -1 : 1;
+
+    int hours;
+    int minutes = 0;
+    int seconds = 0;
+    p = strap_tz_posix_number(p, 167, &hours);
+    if (p && *p == ':')
+    {
+        p = strap_tz_posix_number(p + 1, 59, &minutes);
+        if (p && *p == ':')
+            p = strap_tz_posix_number(p + 1, 59, &seconds);
+    }
+    if (!p)
+        return NULL;
+
+    *out = sign * (hours * 3600 + minutes * 60 + seconds);
+    return p;
+}
+
+static const char *strap_tz_posix_date(const char *p, struct strap_tz_rule_date *date)
+{
+    date->month = 0;
+    date->week = 0;
+    if (*p == 'M')
+    {
+        date->kind = 'M';
+        p = strap_tz_posix_number(p + 1, 12, &date->month);
+        if (p && *p == '.')
+            p = strap_tz_posix_number(p + 1, 5, &date->week);
+        else
+            p = NULL;
+        if (p && *p == '.')
+            p = strap_tz_posix_number(p + 1, 6, &date->day);
+        else
+            p = NULL;
+        if (!p || date->month == 0 || date->week == 0)
+            return NULL;
+    }
+    else if (*p == 'J')
+    {
+        date->kind = 'J';
+        p = strap_tz_posix_number(p + 1, 365, &date->day);
+        if (!p || date->day == 0)
+            return NULL;
+        date->day -= 1;
+    }
+    else
+    {
+        date->kind = 'D';
+        p = strap_tz_posix_number(p, 365, &date->day);
+        if (!p)
+            return NULL;
+    }
+
+    date->time = 2 * 3600;
+    if (*p == '/')
+        p = strap_tz_posix_time(p + 1, &date->time);
+    return p;
+}
+
+/* Parses a POSIX TZ string such as `CET-1CEST,M3.5.0,M10.5.0/3` into the
+ * rule fields of `tz`. POSIX offsets count west of Greenwich, so the signs
+ * are flipped on the way in. */
+static bool strap_tz_parse_posix(const char *s, struct strap_tz *tz)
+{
+    int32_t offset;
+    const char *p = strap_tz_posix_name(s);
+    if (!p || !(p = strap_tz_posix_time(p, &offset)))
+        return false;
+
+    tz->std_offset = -offset;
+    tz->dst_offset = tz->std_offset;
+    tz->rule_has_dst = false;
+    if (*p != '\0')
+    {
+        if (!(p = strap_tz_posix_name(p)))
+            return false;
+
+        tz->dst_offset = tz->std_offset + 3600;
+        if (*p != '\0' && *p != ',')
+        {
+            if (!(p = strap_tz_posix_time(p, &offset)))
+                return false;
+            tz->dst_offset = -offset;
+        }
+
+        /* Without explicit dates POSIX leaves the rule to the
+         * implementation; use the current US rule like glibc. */
+        const char *dates = *p == ',' ? p + 1 : (*p == '\0' ? "M3.2.0,M11.1.0" : NULL);
+        if (!dates || !(p = strap_tz_posix_date(dates, &tz->start)) || *p != ',' ||
+            !(p = strap_tz_posix_date(p + 1, &tz->end)) || *p != '\0')
+            return false;
+        tz->rule_has_dst = true;
+    }
+
+    tz->has_rule = true;
+    return true;
+}
+
+/* Local seconds (in the offset the rule is expressed in) at which `date`
+ * falls in `year`. */
+static int64_t strap_tz_rule_local_time(const struct strap_tz_rule_date *date, int year)
+{
+    int64_t days;
+    if (date->kind == 'M')
+    {
+        int64_t first = strap_days_from_civil(year, (unsigned)date->month, 1);
+        int weekday = (int)((first % 7 + 11) % 7); /* 1970-01-01 was a Thursday */
+        int mday = 1 + (date->day - weekday + 7) % 7 + (date->week - 1) * 7;
+        int dim = strap_days_in_month(year, (unsigned)date->month);
+        while (mday > dim)
+            mday -= 7;
+        days = first + mday - 1;
+    }
+    else
+    {
+        days = strap_days_from_civil(year, 1, 1) + date->day;
+        if (date->kind == 'J' && date->day >= 59 && strap_is_leap(year))
+            ++days;
+    }
+    return days * 86400 + date->time;
+}
+
+static int32_t strap_tz_rule_offset(const struct strap_tz *tz, int64_t when)
+{
+    if (!tz->rule_has_dst)
+        return tz->std_offset;
+
+    int64_t year;
+    unsigned month;
+    unsigned day;
+    strap_civil_from_days(strap_floor_div(when + tz->std_offset, 86400), &year, &month, &day);
+    /* The rule repeats every year; keep strap_days_from_civil in range. */
+    if (year < -1000000)
+        year = -1000000;
+    else if (year > 1000000)
+        year = 1000000;
+
+    /* The start date is given in standard time, the end date in DST. */
+    int64_t start = strap_tz_rule_local_time(&tz->start, (int)year) - tz->std_offset;
+    int64_t end = strap_tz_rule_local_time(&tz->end, (int)year) - tz->dst_offset;
+    bool dst = start < end ? (when >= start && when < end) : (when < end || when >= start);
+    return dst ? tz->dst_offset : tz->std_offset;
+}
+
+/* UTC offset in seconds at `when`; lock-free binary search over the
+ * transitions, deferring to the footer rule past the last one. */
+static int32_t strap_tz_offset_at(const struct strap_tz *tz, int64_t when)
+{
+    size_t lo = 0;
+    size_t hi = tz->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tz->transitions[mid] <= when)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == tz->count && tz->has_rule)
+        return strap_tz_rule_offset(tz, when);
+    return lo == 0 ? tz->initial_offset : tz->offsets[lo - 1];
+}
+
+static struct strap_tz *strap_tz_from_posix(const char *spec)
+{
+    struct strap_tz *tz = strap_tz_alloc(0);
+    if (!tz)
+        return NULL;
+    if (!strap_tz_parse_posix(spec, tz))
+    {
+        strap_free(tz);
+        return NULL;
+    }
+    tz->initial_offset = tz->std_offset;
+    return tz;
+}
+
+/* Builds a table from TZif data (RFC 8536). Version 2+ files are read from
+ * their 64-bit block, including the footer rule. */
+static strap_error_t strap_tz_parse_tzif(const unsigned char *data, size_t len, struct strap_tz **out)
+{
+    size_t pos = 0;
+    size_t time_size = 4;
+    for (int pass = 0;; ++pass)
+    {
+        if (len - pos < 44 || memcmp(data + pos, "TZif", 4) != 0)
+            return STRAP_ERR_INVALID_ARGUMENT;
+
+        const unsigned char *header = data + pos;
+        size_t isutcnt = strap_load_be32(header + 20);
+        size_t isstdcnt = strap_load_be32(header + 24);
+        size_t leapcnt = strap_load_be32(header + 28);
+        size_t timecnt = strap_load_be32(header + 32);
+        size_t typecnt = strap_load_be32(header + 36);
+        size_t charcnt = strap_load_be32(header + 40);
+        if (isutcnt > len || isstdcnt > len || leapcnt > len || timecnt > len || typecnt > len || charcnt > len)
+            return STRAP_ERR_INVALID_ARGUMENT;
+
+        size_t block = timecnt * (time_size + 1) + typecnt * 6 + charcnt + leapcnt * (time_size + 4) + isstdcnt + isutcnt;
+        pos += 44;
+        if (block > len - pos)
+            return STRAP_ERR_INVALID_ARGUMENT;
+
+        if (pass == 0 && header[4] >= '2')
+        {
+            pos += block;
+            time_size = 8;
+            continue;
+        }
+
+        if (typecnt == 0)
+            return STRAP_ERR_INVALID_ARGUMENT;
+
+        const unsigned char *times = data + pos;
+        const unsigned char *indices = times + timecnt * time_size;
+        const unsigned char *types = indices + timecnt;
+        struct strap_tz *tz = strap_tz_alloc(timecnt);
+        if (!tz)
+            return STRAP_ERR_ALLOC;
+
+        tz->initial_offset = (int32_t)strap_load_be32(types);
+        for (size_t i = 0; i < timecnt; ++i)
+        {
+            if (indices[i] >= typecnt)
+            {
+                strap_free(tz);
+                return STRAP_ERR_INVALID_ARGUMENT;
+            }
+            tz->transitions[i] = time_size == 8 ? strap_load_be64(times + i * 8)
+                                                : (int64_t)(int32_t)strap_load_be32(times + i * 4);
+            tz->offsets[i] = (int32_t)strap_load_be32(types + indices[i] * 6);
+        }
+
+        /* Footer: "\n<POSIX TZ string>\n" */
+        pos += block;
+        if (time_size == 8 && pos < len && data[pos] == '\n')
+        {
+            const unsigned char *footer = data + pos + 1;
+            const unsigned char *footer_end = memchr(footer, '\n', len - pos - 1);
+            char rule[128];
+            size_t rule_len = footer_end ? (size_t)(footer_end - footer) : 0;
+            if (rule_len > 0 && rule_len < sizeof(rule))
+            {
+                memcpy(rule, footer, rule_len);
+                rule[rule_len] = '\0';
+                if (!strap_tz_parse_posix(rule, tz))
+                    tz->has_rule = false;
+            }
+        }
+
+        *out = tz;
+        return STRAP_OK;
+    }
+}
+
+/* Returns STRAP_ERR_IO with errno from fopen() when the file is missing. */
+static strap_error_t strap_tz_load_path(const char *path, struct strap_tz **out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return STRAP_ERR_IO;
+
+    size_t len = 0;
+    char *data = afread(f, &len);
+    fclose(f);
+    if (!data)
+        return strap_last_error();
+
+    strap_error_t status = len <= STRAP_TZIF_MAX_SIZE
+                               ? strap_tz_parse_tzif((const unsigned char *)data, len, out)
+                               : STRAP_ERR_INVALID_ARGUMENT;
+    strap_free(data);
+    return status;
+}
+
+/* Resolves `Area/City` against $TZDIR or the system zoneinfo directory. */
+static strap_error_t strap_tz_load_zoneinfo(const char *name, struct strap_tz **out)
+{
+    const char *dir = getenv("TZDIR");
+    if (!dir || dir[0] == '\0')
+        dir = "/usr/share/zoneinfo";
+
+    char path[512];
+    int written = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (written < 0 || (size_t)written >= sizeof(path))
+        return STRAP_ERR_OVERFLOW;
+    return strap_tz_load_path(path, out);
+}
+
+/* Follows the TZ lookup order of the C library: `:path`, an absolute path,
+ * a zoneinfo name or a POSIX TZ string, and /etc/localtime when TZ is
+ * unset. Returns NULL when no table can be built, in which case callers
+ * fall back to localtime. */
+static struct strap_tz *strap_tz_load_local(void)
+{
+#if defined(_WIN32)
+    return NULL;
+#else
+    struct strap_tz *tz = NULL;
+    const char *spec = getenv("TZ");
+    if (!spec)
+        return strap_tz_load_path("/etc/localtime", &tz) == STRAP_OK ? tz : NULL;
+    if (spec[0] == ':')
+        ++spec;
+    if (spec[0] == '\0')
+        return strap_tz_from_posix("UTC0");
+    if (spec[0] == '/')
+        return strap_tz_load_path(spec, &tz) == STRAP_OK ? tz : NULL;
+    if (strap_tz_load_zoneinfo(spec, &tz) == STRAP_OK)
+        return tz;
+    return strap_tz_from_posix(spec);
+#endif
+}
+
+/* The local zone table is loaded on first use and replaced only by
+ * strap_time_local_reload(). Replaced tables are kept until exit because
+ * readers may still be searching them. */
+static void *volatile strap_local_tz = NULL;
+static struct strap_tz *strap_local_tz_retired = NULL;
+static strap_mutex_t strap_local_tz_lock = STRAP_MUTEX_INIT;
+
+/* Published when no table is available, routing lookups to localtime. */
+static struct strap_tz strap_local_tz_none;
+
+static const struct strap_tz *strap_local_tz_publish(bool reload)
+{
+    strap_mutex_lock(&strap_local_tz_lock);
+    struct strap_tz *current = strap_atomic_load_ptr(&strap_local_tz);
+    if (current && !reload)
+    {
+        strap_mutex_unlock(&strap_local_tz_lock);
+        return current;
+    }
+
+    struct strap_tz *fresh = strap_tz_load_local();
+    if (!fresh)
+        fresh = &strap_local_tz_none;
+    strap_atomic_store_ptr(&strap_local_tz, fresh);
+
+    if (current && current != &strap_local_tz_none)
+    {
+        current->next = strap_local_tz_retired;
+        strap_local_tz_retired = current;
+    }
+    strap_mutex_unlock(&strap_local_tz_lock);
+    return fresh;
+}
+
+static const struct strap_tz *strap_local_tz_current(void)
+{
+    const struct strap_tz *tz = strap_atomic_load_ptr(&strap_local_tz);
+    return tz ? tz : strap_local_tz_publish(false);
+}
+
+/* Time utilities */
+struct timeval timeval_add(struct timeval a, struct timeval b)
+{
+    struct timeval result;
+    result.tv_sec = a.tv_sec + b.tv_sec;
+    result.tv_usec = a.tv_usec + b.tv_usec;
+    if (result.tv_usec >= 1000000)
+    {
+        result.tv_sec += 1;
+        result.tv_usec -= 1000000;
+    }
+    return result;
+}
+
+struct timeval timeval_sub(struct timeval a, struct timeval b)
+{
+    struct timeval result;
+    result.tv_sec = a.tv_sec - b.tv_sec;
+    result.tv_usec = a.tv_usec - b.tv_usec;
+    if (result.tv_usec < 0)
+    {
+        result.tv_sec -= 1;
+        result.tv_usec += 1000000;
+    }
+    return result;
+}
+
+double timeval_to_seconds(struct timeval t)
+{
+    return (double)t.tv_sec + (double)t.tv_usec / 1000000.0;
+}
+
+struct timeval timeval_add_minutes(struct timeval t, int minutes)
+{
+    struct timeval result = t;
+    int64_t sec = (int64_t)t.tv_sec + (int64_t)minutes * 60;
+    result.tv_sec = (time_t)sec;
+    return result;
+}
+
+struct timespec timespec_add(struct timespec a, struct timespec b)
+{
+    struct timespec result;
+    result.tv_sec = a.tv_sec + b.tv_sec;
+    result.tv_nsec = a.tv_nsec + b.tv_nsec;
+    if (result.tv_nsec >= 1000000000)
+    {
+        result.tv_sec += 1;
+        result.tv_nsec -= 1000000000;
+    }
+    return result;
+}
+
+struct timespec timespec_sub(struct timespec a, struct timespec b)
+{
+    struct timespec result;
+    result.tv_sec = a.tv_sec - b.tv_sec;
+    result.tv_nsec = a.tv_nsec - b.tv_nsec;
+    if (result.tv_nsec < 0)
+    {
+        result.tv_sec -= 1;
+        result.tv_nsec += 1000000000;
+    }
+    return result;
+}
+
+int64_t timespec_to_ns(struct timespec t)
+{
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+struct timespec timespec_from_ns(int64_t ns)
+{
+    struct timespec result;
+    int64_t sec = strap_floor_div(ns, 1000000000);
+    result.tv_sec = (time_t)sec;
+    result.tv_nsec = (long)(ns - sec * 1000000000);
+    return result;
+}
+
+/* Truncates to whole microseconds. */
+struct timeval timespec_to_timeval(struct timespec t)
+{
+    struct timeval result;
+    result.tv_sec = t.tv_sec;
+    result.tv_usec = (long)(t.tv_nsec / 1000);
+    return result;
+}
+
+struct timespec timeval_to_timespec(struct timeval t)
+{
+    struct timespec result;
+    result.tv_sec = t.tv_sec;
+    result.tv_nsec = (long)t.tv_usec * 1000;
+    return result;
+}
+
+int strap_time_offset_to_string(int offset_minutes, char *buf, size_t bufsize)
+{
+    if (!buf)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    if (offset_minutes != 0 && !strap_offset_valid(offset_minutes))
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    if (bufsize < (offset_minutes == 0 ? 2u : 7u))
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    *strap_write_offset(buf, offset_minutes) = '\0';
+    strap_clear_error();
+    return 0;
+}
+
+int strap_time_parse_tz_offset(const char *str, int *offset_minutes)
+{
+    if (!str || !offset_minutes)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    /* "+HH:MM" is the longest valid form. */
+    if (strap_tz_offset_parse_core(str, strnlen(str, 8), offset_minutes) != STRAP_OK)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    strap_clear_error();
+    return 0;
+}
+
+/* General path for years outside [0, 9999] or out-of-range fractions,
+ * where the output width varies. A positive `fraction` prints with
+ * `fraction_digits` digits. */
+static int strap_time_format_iso8601_wide(int64_t seconds,
+                                          long fraction,
+                                          int fraction_digits,
+                                          int offset_minutes,
+                                          char *buf,
+                                          size_t bufsize)
+{
+    char tzbuf[7];
+    if (strap_time_offset_to_string(offset_minutes, tzbuf, sizeof(tzbuf)) != 0)
+        return -1;
+
+    int64_t local_seconds;
+    if (strap_apply_offset(seconds, offset_minutes, &local_seconds) != 0)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    time_t local_time = (time_t)local_seconds;
+    if ((int64_t)local_time != local_seconds)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    struct tm tm_local;
+    if (strap_gmtime_safe(local_time, &tm_local) != 0)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    int written = snprintf(buf, bufsize, "%04d-%02d-%02dT%02d:%02d:%02d",
+                           tm_local.tm_year + 1900,
+                           tm_local.tm_mon + 1,
+                           tm_local.tm_mday,
+                           tm_local.tm_hour,
+                           tm_local.tm_min,
+                           tm_local.tm_sec);
+    if (written < 0 || (size_t)written >= bufsize)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    size_t pos = (size_t)written;
+
+    if (fraction > 0)
+    {
+        int frac = snprintf(buf + pos, bufsize - pos, ".%0*ld", fraction_digits, fraction);
+        if (frac < 0 || (size_t)frac >= bufsize - pos)
+        {
+            errno = ERANGE;
+            strap_set_error(STRAP_ERR_OVERFLOW);
+            return -1;
+        }
+        pos += (size_t)frac;
+    }
+
+    int tz_written = snprintf(buf + pos, bufsize - pos, "%s", tzbuf);
+    if (tz_written < 0 || (size_t)tz_written >= bufsize - pos)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
     }
 
-    int tail_a = strap_tolower_locale_ctx(*pa, &ctx);
-    int tail_b = strap_tolower_locale_ctx(*pb, &ctx);
-    int diff = tail_a - tail_b;
-
-    strap_locale_exit(&ctx);
     strap_clear_error();
-    return diff;
+    return (int)(pos + (size_t)tz_written);
 }
 
-/* --------------------------------------------------------------------- */
-/* Time helpers                                                           */
+/* Splits UTC seconds shifted by `offset_minutes` into civil fields. */
+static int strap_time_local_fields(int64_t utc_seconds,
+                                   int offset_minutes,
+                                   int64_t *year,
+                                   unsigned *month,
+                                   unsigned *day,
+                                   unsigned *day_seconds)
+{
+    if (!strap_offset_valid(offset_minutes))
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
 
-static int strap_gmtime_safe(time_t value, struct tm *out)
+    int64_t local_seconds;
+    if (strap_apply_offset(utc_seconds, offset_minutes, &local_seconds) != 0)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    if ((int64_t)(time_t)local_seconds != local_seconds)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    int64_t days = local_seconds / 86400;
+    int64_t seconds = local_seconds % 86400;
+    if (seconds < 0)
+    {
+        seconds += 86400;
+        days -= 1;
+    }
+
+    strap_civil_from_days(days, year, month, day);
+    *day_seconds = (unsigned)seconds;
+    return 0;
+}
+
+int strap_time_write_iso8601(struct timeval t, int offset_minutes, char *buf, size_t bufsize)
 {
-    if (!out)
+    if (!buf)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
+    }
 
-#if defined(_WIN32)
-    return gmtime_s(out, &value) == 0 ? 0 : -1;
-#elif defined(_POSIX_THREAD_SAFE_FUNCTIONS) || defined(__unix__) || defined(__APPLE__)
-    return gmtime_r(&value, out) ? 0 : -1;
+    int64_t year;
+    unsigned month, day, day_seconds;
+    if (strap_time_local_fields((int64_t)t.tv_sec, offset_minutes, &year, &month, &day, &day_seconds) != 0)
+        return -1;
+    if (year < 0 || year > 9999 || t.tv_usec < 0 || t.tv_usec > 999999)
+        return strap_time_format_iso8601_wide((int64_t)t.tv_sec, (long)t.tv_usec, 6, offset_minutes, buf, bufsize);
+
+    size_t len = 19 + (t.tv_usec > 0 ? 7 : 0) + (offset_minutes == 0 ? 1 : 6);
+    if (len >= bufsize)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    char *cursor = strap_write_datetime(buf, (unsigned)year, month, day, day_seconds);
+    if (t.tv_usec > 0)
+        cursor = strap_write_micros(cursor, (unsigned)t.tv_usec);
+    cursor = strap_write_offset(cursor, offset_minutes);
+    *cursor = '\0';
+
+    strap_clear_error();
+    return (int)len;
+}
+
+int strap_time_write_iso8601_ns(struct timespec t, int offset_minutes, char *buf, size_t bufsize)
+{
+    if (!buf || t.tv_nsec < 0 || t.tv_nsec > 999999999)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    int64_t year;
+    unsigned month, day, day_seconds;
+    if (strap_time_local_fields((int64_t)t.tv_sec, offset_minutes, &year, &month, &day, &day_seconds) != 0)
+        return -1;
+
+    /* Whole microseconds keep the six-digit form strap_time_write_iso8601()
+     * produces. */
+    unsigned nanos = (unsigned)t.tv_nsec;
+    if (year < 0 || year > 9999)
+    {
+        if (nanos % 1000 == 0)
+            return strap_time_format_iso8601_wide((int64_t)t.tv_sec, (long)(nanos / 1000), 6, offset_minutes, buf, bufsize);
+        return strap_time_format_iso8601_wide((int64_t)t.tv_sec, (long)nanos, 9, offset_minutes, buf, bufsize);
+    }
+
+    size_t fraction_len = nanos == 0 ? 0 : (nanos % 1000 == 0 ? 7 : 10);
+    size_t len = 19 + fraction_len + (offset_minutes == 0 ? 1 : 6);
+    if (len >= bufsize)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    char *cursor = strap_write_datetime(buf, (unsigned)year, month, day, day_seconds);
+    if (fraction_len > 0)
+    {
+        cursor = strap_write_micros(cursor, nanos / 1000);
+        if (fraction_len == 10)
+        {
+            *cursor++ = (char)('0' + nanos % 1000 / 100);
+            cursor = strap_write_2digits(cursor, nanos % 100);
+        }
+    }
+    cursor = strap_write_offset(cursor, offset_minutes);
+    *cursor = '\0';
+
+    strap_clear_error();
+    return (int)len;
+}
+
+int strap_time_format_iso8601(struct timeval t, int offset_minutes, char *buf, size_t bufsize)
+{
+    return strap_time_write_iso8601(t, offset_minutes, buf, bufsize) < 0 ? -1 : 0;
+}
+
+/* Offset reported by the C library, for platforms or settings without a
+ * readable TZif file. */
+static int strap_localtime_offset(time_t when, int64_t *offset_seconds)
+{
+    struct tm local_tm;
+    if (strap_localtime_safe(when, &local_tm) != 0)
+        return -1;
+
+#if STRAP_HAVE_TM_GMTOFF
+    *offset_seconds = (int64_t)local_tm.tm_gmtoff;
 #else
-    struct tm *tmp = gmtime(&value);
-    if (!tmp)
+    struct tm probe = local_tm;
+    time_t local_epoch = mktime(&probe);
+    if (local_epoch == (time_t)-1)
         return -1;
-    *out = *tmp;
+    *offset_seconds = (int64_t)local_epoch - (int64_t)when;
+#endif
     return 0;
+}
+
+int strap_time_local_reload(void)
+{
+#if defined(_WIN32)
+    _tzset();
+#else
+    tzset();
 #endif
+    strap_local_tz_publish(true);
+    strap_clear_error();
+    return 0;
 }
 
-static int strap_localtime_safe(time_t value, struct tm *out)
+/* Accepts whole-minute offsets within ±14 hours, the range the ISO 8601
+ * helpers can represent. */
+static int strap_offset_to_minutes(int64_t offset_seconds, int *offset_minutes)
 {
-    if (!out)
+    if (offset_seconds < -14LL * 3600 || offset_seconds > 14LL * 3600)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
         return -1;
+    }
 
-#if defined(_WIN32)
-    return localtime_s(out, &value) == 0 ? 0 : -1;
-#elif defined(_POSIX_THREAD_SAFE_FUNCTIONS) || defined(__unix__) || defined(__APPLE__)
-    return localtime_r(&value, out) ? 0 : -1;
-#else
-    struct tm *tmp = localtime(&value);
-    if (!tmp)
+    if (offset_seconds % 60 != 0)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
-    *out = *tmp;
+    }
+
+    int candidate = (int)(offset_seconds / 60);
+    if ((int64_t)candidate != offset_seconds / 60)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    *offset_minutes = candidate;
+    strap_clear_error();
     return 0;
-#endif
 }
 
-static int strap_is_leap(int year)
+int strap_time_local_offset(time_t when, int *offset_minutes)
 {
-    return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+    if (!offset_minutes)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    int64_t offset_seconds;
+    const struct strap_tz *tz = strap_local_tz_current();
+    if (tz != &strap_local_tz_none)
+        offset_seconds = strap_tz_offset_at(tz, (int64_t)when);
+    else if (strap_localtime_offset(when, &offset_seconds) != 0)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    return strap_offset_to_minutes(offset_seconds, offset_minutes);
 }
 
-static int strap_days_in_month(int year, unsigned month)
+int strap_time_format_iso8601_local(struct timeval t, char *buf, size_t bufsize)
 {
-    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    if (month < 1 || month > 12)
-        return 0;
-    if (month == 2 && strap_is_leap(year))
-        return 29;
-    return days[month - 1];
+    int offset_minutes;
+    if (strap_time_local_offset(t.tv_sec, &offset_minutes) != 0)
+        return -1;
+    return strap_time_format_iso8601(t, offset_minutes, buf, bufsize);
+}
+
+/* Named zones are loaded once and kept for the lifetime of the process.
+ * Readers walk the published list without locking; inserts are
+ * serialised by strap_tz_cache_lock. */
+static void *volatile strap_tz_cache = NULL;
+static strap_mutex_t strap_tz_cache_lock = STRAP_MUTEX_INIT;
+
+static const struct strap_tz *strap_tz_cache_find(const struct strap_tz *tz, const char *name)
+{
+    for (; tz; tz = tz->next)
+    {
+        if (strcmp(tz->name, name) == 0)
+            return tz;
+    }
+    return NULL;
+}
+
+/* Zone names come from callers such as per-customer settings, so only
+ * relative paths below the zoneinfo directory are accepted. */
+static bool strap_tz_name_valid(const char *name)
+{
+    if (!name || name[0] == '\0' || name[0] == '/')
+        return false;
+
+    size_t len = strnlen(name, 256);
+    if (len == 256)
+        return false;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        char c = name[i];
+        if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || strap_is_digit(c) || c == '/' || c == '_' ||
+              c == '-' || c == '+' || c == '.'))
+            return false;
+        if (c == '.' && (i == 0 || name[i - 1] == '/'))
+            return false;
+    }
+    return true;
+}
+
+const strap_tz_t *strap_tz_load(const char *name)
+{
+    if (!strap_tz_name_valid(name))
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    const struct strap_tz *found = strap_tz_cache_find(strap_atomic_load_ptr(&strap_tz_cache), name);
+    if (found)
+    {
+        strap_clear_error();
+        return found;
+    }
+
+    strap_error_t status = STRAP_OK;
+    int saved_errno = 0;
+    strap_mutex_lock(&strap_tz_cache_lock);
+    struct strap_tz *head = strap_atomic_load_ptr(&strap_tz_cache);
+    found = strap_tz_cache_find(head, name);
+    if (!found)
+    {
+        struct strap_tz *tz = NULL;
+        status = strap_tz_load_zoneinfo(name, &tz);
+        saved_errno = errno;
+        if (status == STRAP_OK && !(tz->name = strap_mem_strdup(name)))
+        {
+            strap_free(tz);
+            status = STRAP_ERR_ALLOC;
+        }
+        if (status == STRAP_OK)
+        {
+            tz->next = head;
+            strap_atomic_store_ptr(&strap_tz_cache, tz);
+            found = tz;
+        }
+    }
+    strap_mutex_unlock(&strap_tz_cache_lock);
+
+    if (!found)
+    {
+        switch (status)
+        {
+        case STRAP_ERR_IO:
+            errno = saved_errno;
+            break;
+        case STRAP_ERR_ALLOC:
+            errno = ENOMEM;
+            break;
+        case STRAP_ERR_OVERFLOW:
+            errno = ENAMETOOLONG;
+            break;
+        default:
+            errno = EINVAL;
+            break;
+        }
+        strap_set_error(status);
+        return NULL;
+    }
+
+    strap_clear_error();
+    return found;
+}
+
+const char *strap_tz_name(const strap_tz_t *tz)
+{
+    if (!tz)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return NULL;
+    }
+    return tz->name;
+}
+
+int strap_tz_offset(const strap_tz_t *tz, time_t when, int *offset_minutes)
+{
+    if (!tz || !offset_minutes)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+    return strap_offset_to_minutes(strap_tz_offset_at(tz, (int64_t)when), offset_minutes);
+}
+
+int strap_tz_local_to_utc(const strap_tz_t *tz, time_t local, time_t *out)
+{
+    if (!tz || !out)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    int64_t wall = (int64_t)local;
+    if (wall < INT64_MIN + 2 * 86400 || wall > INT64_MAX - 2 * 86400)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    /* Try the offsets in effect a day either side. A wall time valid under
+     * both sits in a fold and takes the earlier instant; one valid under
+     * neither sits in a gap and is read with the earlier offset, which
+     * moves it forward past the gap. */
+    int32_t before = strap_tz_offset_at(tz, wall - 86400);
+    int32_t after = strap_tz_offset_at(tz, wall + 86400);
+    int64_t utc_before = wall - before;
+    int64_t utc_after = wall - after;
+    bool before_valid = strap_tz_offset_at(tz, utc_before) == before;
+    bool after_valid = strap_tz_offset_at(tz, utc_after) == after;
+
+    int64_t utc = utc_before;
+    if (after_valid && (!before_valid || utc_after < utc_before))
+        utc = utc_after;
+
+    time_t result = (time_t)utc;
+    if ((int64_t)result != utc)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    *out = result;
+    strap_clear_error();
+    return 0;
 }
 
-static int64_t strap_days_from_civil(int year, unsigned month, unsigned day)
+int strap_time_format_iso8601_tz(struct timeval t, const strap_tz_t *tz, char *buf, size_t bufsize)
 {
-    year -= month <= 2;
-    const int era = (year >= 0 ? year : year - 399) / 400;
-    const unsigned yoe = (unsigned)(year - era * 400);
-    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
-    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
-    return era * 146097 + (int64_t)doe - 719468;
+    int offset_minutes;
+    if (strap_tz_offset(tz, t.tv_sec, &offset_minutes) != 0)
+        return -1;
+    return strap_time_format_iso8601(t, offset_minutes, buf, bufsize);
 }
 
-static int strap_tm_to_epoch(const struct tm *tm_utc, int64_t *out_seconds)
+int strap_time_now_coarse(struct timeval *out)
 {
-    if (!tm_utc || !out_seconds)
-        return -1;
-
-    int year = tm_utc->tm_year + 1900;
-    unsigned month = (unsigned)(tm_utc->tm_mon + 1);
-    unsigned day = (unsigned)tm_utc->tm_mday;
-    int hour = tm_utc->tm_hour;
-    int minute = tm_utc->tm_min;
-    int second = tm_utc->tm_sec;
-
-    if (hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60)
+    if (!out)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
+    }
 
-    int dim = strap_days_in_month(year, month);
-    if (dim == 0 || day == 0 || day > (unsigned)dim)
+#if defined(_WIN32)
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    ticks -= 116444736000000000ULL; /* 1601-01-01 to 1970-01-01 in 100 ns units */
+    out->tv_sec = (long)(ticks / 10000000);
+    out->tv_usec = (long)(ticks % 10000000 / 10);
+#else
+    struct timespec ts;
+#    if defined(CLOCK_REALTIME_COARSE)
+    int rc = clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+#    else
+    int rc = clock_gettime(CLOCK_REALTIME, &ts);
+#    endif
+    if (rc != 0)
+    {
+        strap_set_error(STRAP_ERR_IO);
         return -1;
+    }
+    out->tv_sec = ts.tv_sec;
+    out->tv_usec = (suseconds_t)(ts.tv_nsec / 1000);
+#endif
 
-    int64_t days = strap_days_from_civil(year, month, day);
+    strap_clear_error();
+    return 0;
+}
 
-    int64_t seconds_from_days;
-    if ((days > 0 && days > INT64_MAX / 86400) || (days < 0 && days < INT64_MIN / 86400))
-        return -1;
-    seconds_from_days = days * 86400;
+/* Time formatter cache */
+static void strap_time_formatter_reset(strap_time_formatter_t *formatter, int offset_minutes, bool local)
+{
+    formatter->minute = INT64_MIN;
+    formatter->offset_minutes = offset_minutes;
+    formatter->local = local;
+    formatter->prefix[0] = '\0';
+    formatter->suffix[0] = '\0';
+    formatter->suffix_len = 0;
+}
 
-    int64_t day_seconds = (int64_t)hour * 3600 + (int64_t)minute * 60 + (int64_t)second;
-    if ((day_seconds > 0 && seconds_from_days > INT64_MAX - day_seconds) ||
-        (day_seconds < 0 && seconds_from_days < INT64_MIN - day_seconds))
+int strap_time_formatter_init(strap_time_formatter_t *formatter, int offset_minutes)
+{
+    if (!formatter || !strap_offset_valid(offset_minutes))
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
+    }
 
-    *out_seconds = seconds_from_days + day_seconds;
+    strap_time_formatter_reset(formatter, offset_minutes, false);
+    strap_clear_error();
     return 0;
 }
 
-static int strap_apply_offset(int64_t base, int offset_minutes, int64_t *out_seconds)
+int strap_time_formatter_init_local(strap_time_formatter_t *formatter)
 {
-    int64_t delta = (int64_t)offset_minutes * 60;
-    if ((delta > 0 && base > INT64_MAX - delta) || (delta < 0 && base < INT64_MIN - delta))
+    if (!formatter)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
-    *out_seconds = base + delta;
+    }
+
+    strap_time_formatter_reset(formatter, 0, true);
+    strap_clear_error();
     return 0;
 }
 
-/* Time utilities */
-struct timeval timeval_add(struct timeval a, struct timeval b)
+/* Offsets are whole minutes, so local minute boundaries coincide with UTC
+ * ones and the cache can be keyed on the UTC minute. For the local zone the
+ * offset is looked up once per minute. */
+int strap_time_formatter_format(strap_time_formatter_t *formatter, struct timeval t, char *buf, size_t bufsize)
 {
-    struct timeval result;
-    result.tv_sec = a.tv_sec + b.tv_sec;
-    result.tv_usec = a.tv_usec + b.tv_usec;
-    if (result.tv_usec >= 1000000)
+    if (!formatter || !buf)
     {
-        result.tv_sec += 1;
-        result.tv_usec -= 1000000;
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        return -1;
     }
-    return result;
-}
 
-struct timeval timeval_sub(struct timeval a, struct timeval b)
-{
-    struct timeval result;
-    result.tv_sec = a.tv_sec - b.tv_sec;
-    result.tv_usec = a.tv_usec - b.tv_usec;
-    if (result.tv_usec < 0)
+    int64_t seconds = (int64_t)t.tv_sec;
+    int64_t minute = seconds / 60 - (seconds % 60 < 0);
+    unsigned second = (unsigned)(seconds - minute * 60);
+
+    if (minute != formatter->minute || t.tv_usec < 0 || t.tv_usec > 999999)
     {
-        result.tv_sec -= 1;
-        result.tv_usec += 1000000;
+        int offset_minutes = formatter->offset_minutes;
+        if (formatter->local && strap_time_local_offset(t.tv_sec, &offset_minutes) != 0)
+            return -1;
+
+        int len = strap_time_write_iso8601(t, offset_minutes, buf, bufsize);
+        if (len < 0)
+            return -1;
+
+        /* Only the fixed 19-byte layout is cached. */
+        formatter->minute = INT64_MIN;
+        formatter->offset_minutes = offset_minutes;
+        if (buf[4] == '-' && t.tv_usec >= 0 && t.tv_usec <= 999999)
+        {
+            memcpy(formatter->prefix, buf, 17);
+            formatter->suffix_len = strap_write_offset(formatter->suffix, offset_minutes) - formatter->suffix;
+            formatter->minute = minute;
+        }
+        return len;
     }
-    return result;
-}
 
-double timeval_to_seconds(struct timeval t)
-{
-    return (double)t.tv_sec + (double)t.tv_usec / 1000000.0;
+    size_t len = 19 + (t.tv_usec > 0 ? 7 : 0) + formatter->suffix_len;
+    if (len >= bufsize)
+    {
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return -1;
+    }
+
+    memcpy(buf, formatter->prefix, 17);
+    char *cursor = strap_write_2digits(buf + 17, second);
+    if (t.tv_usec > 0)
+        cursor = strap_write_micros(cursor, (unsigned)t.tv_usec);
+    memcpy(cursor, formatter->suffix, formatter->suffix_len);
+    cursor[formatter->suffix_len] = '\0';
+
+    strap_clear_error();
+    return (int)len;
 }
 
-struct timeval timeval_add_minutes(struct timeval t, int minutes)
+int strap_time_formatter_format_now(strap_time_formatter_t *formatter, char *buf, size_t bufsize)
 {
-    struct timeval result = t;
-    int64_t sec = (int64_t)t.tv_sec + (int64_t)minutes * 60;
-    result.tv_sec = (time_t)sec;
-    return result;
+    struct timeval now;
+    if (strap_time_now_coarse(&now) != 0)
+        return -1;
+    return strap_time_formatter_format(formatter, now, buf, bufsize);
 }
 
-int strap_time_offset_to_string(int offset_minutes, char *buf, size_t bufsize)
+int strap_time_parse_iso8601(const char *str, struct timeval *out, int *offset_minutes)
 {
-    if (!buf)
+    if (!str || !out)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    if (offset_minutes == 0)
+    /* Anything longer than the longest valid form is rejected by the core
+     * anyway, so the scan is bounded. */
+    size_t len = strnlen(str, STRAP_ISO8601_MAX_LEN + 1);
+
+    int64_t utc_seconds;
+    int32_t micro;
+    int parsed_offset;
+    strap_error_t status = strap_iso8601_parse_core(str, len, NULL, 6, &utc_seconds, &micro, &parsed_offset);
+    if (status == STRAP_OK && (int64_t)(time_t)utc_seconds != utc_seconds)
+        status = STRAP_ERR_OVERFLOW;
+    if (status != STRAP_OK)
     {
-        if (bufsize < 2)
-        {
-            errno = ERANGE;
-            strap_set_error(STRAP_ERR_OVERFLOW);
-            return -1;
-        }
-        buf[0] = 'Z';
-        buf[1] = '\0';
-        strap_clear_error();
-        return 0;
+        errno = status == STRAP_ERR_OVERFLOW ? ERANGE : EINVAL;
+        strap_set_error(status);
+        return -1;
     }
 
-    if (offset_minutes < -14 * 60 || offset_minutes > 14 * 60)
+    out->tv_sec = (time_t)utc_seconds;
+    out->tv_usec = micro;
+
+    if (offset_minutes)
+        *offset_minutes = parsed_offset;
+
+    strap_clear_error();
+    return 0;
+}
+
+int strap_time_parse_iso8601_ns(const char *str, struct timespec *out, int *offset_minutes)
+{
+    if (!str || !out)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    if (bufsize < 7)
+    size_t len = strnlen(str, STRAP_ISO8601_NS_MAX_LEN + 1);
+
+    int64_t utc_seconds;
+    int32_t nanos;
+    int parsed_offset;
+    strap_error_t status = strap_iso8601_parse_core(str, len, NULL, 9, &utc_seconds, &nanos, &parsed_offset);
+    if (status == STRAP_OK && (int64_t)(time_t)utc_seconds != utc_seconds)
+        status = STRAP_ERR_OVERFLOW;
+    if (status != STRAP_OK)
     {
-        errno = ERANGE;
-        strap_set_error(STRAP_ERR_OVERFLOW);
+        errno = status == STRAP_ERR_OVERFLOW ? ERANGE : EINVAL;
+        strap_set_error(status);
         return -1;
     }
 
-    int sign = offset_minutes < 0 ? -1 : 1;
-    int total = offset_minutes * sign;
-    int hours = total / 60;
-    int minutes = total % 60;
+    out->tv_sec = (time_t)utc_seconds;
+    out->tv_nsec = nanos;
+
+    if (offset_minutes)
+        *offset_minutes = parsed_offset;
+
+    strap_clear_error();
+    return 0;
+}
+
+/* Parses one batch element. Failed slots are zeroed so the output columns
+ * stay dense. */
+static strap_error_t strap_iso8601_parse_slot(const char *s,
+                                              size_t len,
+                                              struct strap_iso8601_day_memo *memo,
+                                              int64_t *out_us,
+                                              int16_t *out_offset)
+{
+    int64_t seconds = 0;
+    int32_t micro = 0;
+    int offset = 0;
+    strap_error_t status = s ? strap_iso8601_parse_core(s, len, memo, 6, &seconds, &micro, &offset)
+                             : STRAP_ERR_INVALID_ARGUMENT;
+    if (status != STRAP_OK)
+    {
+        seconds = 0;
+        micro = 0;
+        offset = 0;
+    }
+
+    /* Years are limited to four digits, so this cannot overflow. */
+    *out_us = seconds * 1000000 + micro;
+    if (out_offset)
+        *out_offset = (int16_t)offset;
+    return status;
+}
 
-    if (hours == 14 && minutes != 0)
+/* Reports a whole batch through a single error-state update. */
+static int strap_iso8601_batch_finish(strap_error_t first_failure)
+{
+    if (first_failure != STRAP_OK)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        errno = first_failure == STRAP_ERR_OVERFLOW ? ERANGE : EINVAL;
+        strap_set_error(first_failure);
         return -1;
     }
-
-    snprintf(buf, bufsize, "%c%02d:%02d", sign < 0 ? '-' : '+', hours, minutes);
     strap_clear_error();
     return 0;
 }
 
-int strap_time_parse_tz_offset(const char *str, int *offset_minutes)
+int strap_time_parse_iso8601_batch(const char *const *strs,
+                                   size_t n,
+                                   int64_t *out_us,
+                                   int16_t *out_offsets,
+                                   uint8_t *out_status)
 {
-    if (!str || !offset_minutes)
+    if (n > 0 && (!strs || !out_us))
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    if ((str[0] == 'Z' || str[0] == 'z') && str[1] == '\0')
+    struct strap_iso8601_day_memo memo = {false, 0, 0, 0};
+    strap_error_t first_failure = STRAP_OK;
+    for (size_t i = 0; i < n; ++i)
     {
-        *offset_minutes = 0;
-        strap_clear_error();
-        return 0;
+        const char *s = strs[i];
+        size_t len = s ? strnlen(s, STRAP_ISO8601_MAX_LEN + 1) : 0;
+        strap_error_t status = strap_iso8601_parse_slot(s, len, &memo, &out_us[i], out_offsets ? &out_offsets[i] : NULL);
+        if (out_status)
+            out_status[i] = (uint8_t)status;
+        if (status != STRAP_OK && first_failure == STRAP_OK)
+            first_failure = status;
     }
+    return strap_iso8601_batch_finish(first_failure);
+}
 
-    int sign;
-    if (str[0] == '+')
-        sign = 1;
-    else if (str[0] == '-')
-        sign = -1;
-    else
+int strap_time_parse_iso8601_batch_views(const strap_str_view_t *views,
+                                         size_t n,
+                                         int64_t *out_us,
+                                         int16_t *out_offsets,
+                                         uint8_t *out_status)
+{
+    if (n > 0 && (!views || !out_us))
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    const char *p = str + 1;
-    if (!isdigit((unsigned char)p[0]) || !isdigit((unsigned char)p[1]))
+    struct strap_iso8601_day_memo memo = {false, 0, 0, 0};
+    strap_error_t first_failure = STRAP_OK;
+    for (size_t i = 0; i < n; ++i)
+    {
+        strap_error_t status = strap_iso8601_parse_slot(views[i].ptr, views[i].len, &memo, &out_us[i],
+                                                        out_offsets ? &out_offsets[i] : NULL);
+        if (out_status)
+            out_status[i] = (uint8_t)status;
+        if (status != STRAP_OK && first_failure == STRAP_OK)
+            first_failure = status;
+    }
+    return strap_iso8601_batch_finish(first_failure);
+}
+
+/* Compiled strptime/strftime-style formats */
+
+enum strap_time_op_kind
+{
+    STRAP_TIME_OP_LITERAL,
+    STRAP_TIME_OP_SPACE,
+    STRAP_TIME_OP_WEEKDAY_NAME,
+    STRAP_TIME_OP_MONTH_NAME,
+    STRAP_TIME_OP_MONTH,
+    STRAP_TIME_OP_DAY,
+    STRAP_TIME_OP_DAY_SPACE,
+    STRAP_TIME_OP_YEAR,
+    STRAP_TIME_OP_YEAR2,
+    STRAP_TIME_OP_HOUR,
+    STRAP_TIME_OP_MINUTE,
+    STRAP_TIME_OP_SECOND,
+    STRAP_TIME_OP_FRACTION,
+    STRAP_TIME_OP_OFFSET
+};
+
+struct strap_time_op
+{
+    unsigned char kind;
+    size_t literal_pos; /* into strap_time_format.literals */
+    size_t literal_len;
+};
+
+struct strap_time_format
+{
+    size_t count;
+    char *literals;
+    struct strap_time_op ops[];
+};
+
+static const char strap_month_names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+static const char strap_weekday_names[] = "SunMonTueWedThuFriSat";
+
+/* Matches a three-letter English name case-insensitively; returns its
+ * zero-based index or -1. */
+static int strap_time_match_name(const char *s, const char *names, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const char *name = names + i * 3;
+        if (strap_ascii_tolower((unsigned char)s[0]) == strap_ascii_tolower((unsigned char)name[0]) &&
+            strap_ascii_tolower((unsigned char)s[1]) == strap_ascii_tolower((unsigned char)name[1]) &&
+            strap_ascii_tolower((unsigned char)s[2]) == strap_ascii_tolower((unsigned char)name[2]))
+            return i;
+    }
+    return -1;
+}
+
+/* Reads between one and `max_digits` digits. */
+static const char *strap_time_read_digits(const char *s, int max_digits, unsigned *out)
+{
+    if (!strap_is_digit(*s))
+        return NULL;
+
+    unsigned value = 0;
+    for (int i = 0; i < max_digits && strap_is_digit(*s); ++i)
+        value = value * 10 + (unsigned)(*s++ - '0');
+    *out = value;
+    return s;
+}
+
+static bool strap_time_is_space(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+strap_time_format_t *strap_time_format_compile(const char *fmt)
+{
+    if (!fmt)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return -1;
+        return NULL;
     }
 
-    int hours = (p[0] - '0') * 10 + (p[1] - '0');
-    p += 2;
+    /* Every op consumes at least one format byte, so the format length
+     * bounds both the op count and the literal bytes. */
+    size_t fmt_len = strlen(fmt);
+    size_t ops_size = fmt_len * sizeof(struct strap_time_op);
+    if (fmt_len > (SIZE_MAX - sizeof(struct strap_time_format) - 1) / (sizeof(struct strap_time_op) + 1))
+    {
+        errno = EOVERFLOW;
+        strap_set_error(STRAP_ERR_OVERFLOW);
+        return NULL;
+    }
 
-    int minutes = 0;
-    if (*p == ':')
+    strap_time_format_t *format = strap_mem_alloc(sizeof(*format) + ops_size + fmt_len + 1);
+    if (!format)
     {
-        ++p;
-        if (!isdigit((unsigned char)p[0]) || !isdigit((unsigned char)p[1]))
+        errno = ENOMEM;
+        strap_set_error(STRAP_ERR_ALLOC);
+        return NULL;
+    }
+    format->count = 0;
+    format->literals = (char *)format + sizeof(*format) + ops_size;
+
+    size_t literal_len = 0;
+    for (const char *p = fmt; *p; ++p)
+    {
+        struct strap_time_op *op = &format->ops[format->count];
+        if (strap_time_is_space(*p))
+        {
+            while (strap_time_is_space(p[1]))
+                ++p;
+            op->kind = STRAP_TIME_OP_SPACE;
+            ++format->count;
+            continue;
+        }
+
+        if (*p != '%' || p[1] == '%')
+        {
+            if (*p == '%')
+                ++p;
+            /* Extend the previous literal when they are adjacent. */
+            if (format->count > 0 && op[-1].kind == STRAP_TIME_OP_LITERAL)
+                op[-1].literal_len++;
+            else
+            {
+                op->kind = STRAP_TIME_OP_LITERAL;
+                op->literal_pos = literal_len;
+                op->literal_len = 1;
+                ++format->count;
+            }
+            format->literals[literal_len++] = *p;
+            continue;
+        }
+
+        switch (*++p)
         {
+        case 'a':
+            op->kind = STRAP_TIME_OP_WEEKDAY_NAME;
+            break;
+        case 'b':
+            op->kind = STRAP_TIME_OP_MONTH_NAME;
+            break;
+        case 'm':
+            op->kind = STRAP_TIME_OP_MONTH;
+            break;
+        case 'd':
+            op->kind = STRAP_TIME_OP_DAY;
+            break;
+        case 'e':
+            op->kind = STRAP_TIME_OP_DAY_SPACE;
+            break;
+        case 'Y':
+            op->kind = STRAP_TIME_OP_YEAR;
+            break;
+        case 'y':
+            op->kind = STRAP_TIME_OP_YEAR2;
+            break;
+        case 'H':
+            op->kind = STRAP_TIME_OP_HOUR;
+            break;
+        case 'M':
+            op->kind = STRAP_TIME_OP_MINUTE;
+            break;
+        case 'S':
+            op->kind = STRAP_TIME_OP_SECOND;
+            break;
+        case 'f':
+            op->kind = STRAP_TIME_OP_FRACTION;
+            break;
+        case 'z':
+            op->kind = STRAP_TIME_OP_OFFSET;
+            break;
+        default:
+            strap_free(format);
             errno = EINVAL;
             strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-            return -1;
+            return NULL;
         }
-        minutes = (p[0] - '0') * 10 + (p[1] - '0');
-        p += 2;
-    }
-    else if (isdigit((unsigned char)p[0]) && isdigit((unsigned char)p[1]))
-    {
-        minutes = (p[0] - '0') * 10 + (p[1] - '0');
-        p += 2;
-    }
-    else if (*p == '\0')
-    {
-        minutes = 0;
+        ++format->count;
     }
-    else
+
+    strap_clear_error();
+    return format;
+}
+
+void strap_time_format_free(strap_time_format_t *format)
+{
+    strap_free(format);
+}
+
+int strap_time_format_parse(const strap_time_format_t *format, const char *str, struct timeval *out, int *offset_minutes)
+{
+    if (!format || !str || !out)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    if (*p != '\0')
+    unsigned year = 1970;
+    unsigned month = 1;
+    unsigned day = 1;
+    unsigned hour = 0;
+    unsigned minute = 0;
+    unsigned second = 0;
+    unsigned micro = 0;
+    int offset = 0;
+    const char *s = str;
+
+    for (size_t i = 0; i < format->count && s; ++i)
+    {
+        const struct strap_time_op *op = &format->ops[i];
+        switch (op->kind)
+        {
+        case STRAP_TIME_OP_LITERAL:
+            s = strncmp(s, format->literals + op->literal_pos, op->literal_len) == 0 ? s + op->literal_len : NULL;
+            break;
+        case STRAP_TIME_OP_SPACE:
+            while (strap_time_is_space(*s))
+                ++s;
+            break;
+        case STRAP_TIME_OP_WEEKDAY_NAME:
+            /* Checked for spelling only; the date fields decide the day. */
+            s = strnlen(s, 3) == 3 && strap_time_match_name(s, strap_weekday_names, 7) >= 0 ? s + 3 : NULL;
+            break;
+        case STRAP_TIME_OP_MONTH_NAME:
+        {
+            int index = strnlen(s, 3) == 3 ? strap_time_match_name(s, strap_month_names, 12) : -1;
+            month = (unsigned)(index + 1);
+            s = index >= 0 ? s + 3 : NULL;
+            break;
+        }
+        case STRAP_TIME_OP_MONTH:
+            s = strap_time_read_digits(s, 2, &month);
+            break;
+        case STRAP_TIME_OP_DAY_SPACE:
+            if (*s == ' ')
+                ++s;
+            s = strap_time_read_digits(s, 2, &day);
+            break;
+        case STRAP_TIME_OP_DAY:
+            s = strap_time_read_digits(s, 2, &day);
+            break;
+        case STRAP_TIME_OP_YEAR:
+        {
+            const char *start = s;
+            s = strap_time_read_digits(s, 4, &year);
+            if (s && s - start != 4)
+                s = NULL;
+            break;
+        }
+        case STRAP_TIME_OP_YEAR2:
+            s = strap_time_read_digits(s, 2, &year);
+            /* POSIX pivot: 69-99 are 1969-1999, 00-68 are 2000-2068. */
+            year += year < 69 ? 2000 : 1900;
+            break;
+        case STRAP_TIME_OP_HOUR:
+            s = strap_time_read_digits(s, 2, &hour);
+            break;
+        case STRAP_TIME_OP_MINUTE:
+            s = strap_time_read_digits(s, 2, &minute);
+            break;
+        case STRAP_TIME_OP_SECOND:
+            s = strap_time_read_digits(s, 2, &second);
+            break;
+        case STRAP_TIME_OP_FRACTION:
+        {
+            const char *start = s;
+            s = strap_time_read_digits(s, 6, &micro);
+            if (s)
+            {
+                for (ptrdiff_t digits = s - start; digits < 6; ++digits)
+                    micro *= 10;
+                if (strap_is_digit(*s))
+                    s = NULL;
+            }
+            break;
+        }
+        case STRAP_TIME_OP_OFFSET:
+        {
+            size_t len = 0;
+            if (*s == 'Z' || *s == 'z')
+                len = 1;
+            else if (*s == '+' || *s == '-')
+            {
+                len = 1;
+                while (len < 6 && (strap_is_digit(s[len]) || (len == 3 && s[len] == ':')))
+                    ++len;
+            }
+            s = len > 0 && strap_tz_offset_parse_core(s, len, &offset) == STRAP_OK ? s + len : NULL;
+            break;
+        }
+        default:
+            s = NULL;
+            break;
+        }
+    }
+
+    int dim = strap_days_in_month((int)year, month);
+    if (!s || hour > 23 || minute > 59 || second > 60 || dim == 0 || day == 0 || day > (unsigned)dim)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    if (hours > 14 || minutes >= 60 || (hours == 14 && minutes != 0))
+    int64_t local_seconds = strap_days_from_civil((int)year, month, day) * 86400 +
+                            (int64_t)hour * 3600 + (int64_t)minute * 60 + (int64_t)second;
+    int64_t utc_seconds = local_seconds - (int64_t)offset * 60;
+    if ((int64_t)(time_t)utc_seconds != utc_seconds)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        errno = ERANGE;
+        strap_set_error(STRAP_ERR_OVERFLOW);
         return -1;
     }
 
-    *offset_minutes = sign * (hours * 60 + minutes);
+    out->tv_sec = (time_t)utc_seconds;
+    out->tv_usec = (long)micro;
+    if (offset_minutes)
+        *offset_minutes = offset;
+
     strap_clear_error();
-    return 0;
+    return (int)(s - str);
 }
 
-int strap_time_format_iso8601(struct timeval t, int offset_minutes, char *buf, size_t bufsize)
+/* Bytes `op` writes; every field has a fixed width. */
+static size_t strap_time_op_width(const struct strap_time_op *op)
 {
-    if (!buf)
+    switch (op->kind)
+    {
+    case STRAP_TIME_OP_LITERAL:
+        return op->literal_len;
+    case STRAP_TIME_OP_SPACE:
+        return 1;
+    case STRAP_TIME_OP_WEEKDAY_NAME:
+    case STRAP_TIME_OP_MONTH_NAME:
+        return 3;
+    case STRAP_TIME_OP_YEAR:
+        return 4;
+    case STRAP_TIME_OP_OFFSET:
+        return 5;
+    case STRAP_TIME_OP_FRACTION:
+        return 6;
+    default:
+        return 2;
+    }
+}
+
+int strap_time_format_write(const strap_time_format_t *format, struct timeval t, int offset_minutes, char *buf, size_t bufsize)
+{
+    if (!format || !buf || !strap_offset_valid(offset_minutes) || t.tv_usec < 0 || t.tv_usec > 999999)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    char tzbuf[7];
-    if (strap_time_offset_to_string(offset_minutes, tzbuf, sizeof(tzbuf)) != 0)
-        return -1;
-
-    int64_t local_seconds;
-    if (strap_apply_offset((int64_t)t.tv_sec, offset_minutes, &local_seconds) != 0)
+    /* Even an empty format needs room for the terminator. */
+    if (bufsize == 0)
     {
         errno = ERANGE;
         strap_set_error(STRAP_ERR_OVERFLOW);
         return -1;
     }
 
-    time_t local_time = (time_t)local_seconds;
-    if ((int64_t)local_time != local_seconds)
+    int64_t local_seconds;
+    if (strap_apply_offset((int64_t)t.tv_sec, offset_minutes, &local_seconds) != 0)
     {
         errno = ERANGE;
         strap_set_error(STRAP_ERR_OVERFLOW);
         return -1;
     }
 
-    struct tm tm_local;
-    if (strap_gmtime_safe(local_time, &tm_local) != 0)
-    {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return -1;
-    }
-
-    int written = snprintf(buf, bufsize, "%04d-%02d-%02dT%02d:%02d:%02d",
-                           tm_local.tm_year + 1900,
-                           tm_local.tm_mon + 1,
-                           tm_local.tm_mday,
-                           tm_local.tm_hour,
-                           tm_local.tm_min,
-                           tm_local.tm_sec);
-    if (written < 0 || (size_t)written >= bufsize)
+    int64_t days = strap_floor_div(local_seconds, 86400);
+    unsigned day_seconds = (unsigned)(local_seconds - days * 86400);
+    int64_t year;
+    unsigned month;
+    unsigned day;
+    strap_civil_from_days(days, &year, &month, &day);
+    if (year < 0 || year > 9999)
     {
         errno = ERANGE;
         strap_set_error(STRAP_ERR_OVERFLOW);
         return -1;
     }
 
-    size_t pos = (size_t)written;
-
-    if (t.tv_usec > 0)
+    char *dst = buf;
+    char *const end = buf + bufsize;
+    for (size_t i = 0; i < format->count; ++i)
     {
-        int frac = snprintf(buf + pos, bufsize - pos, ".%06ld", (long)t.tv_usec);
-        if (frac < 0 || (size_t)frac >= bufsize - pos)
+        const struct strap_time_op *op = &format->ops[i];
+        if ((size_t)(end - dst) <= strap_time_op_width(op))
         {
             errno = ERANGE;
             strap_set_error(STRAP_ERR_OVERFLOW);
             return -1;
         }
-        pos += (size_t)frac;
-    }
 
-    int tz_written = snprintf(buf + pos, bufsize - pos, "%s", tzbuf);
-    if (tz_written < 0 || (size_t)tz_written >= bufsize - pos)
-    {
-        errno = ERANGE;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return -1;
+        switch (op->kind)
+        {
+        case STRAP_TIME_OP_LITERAL:
+            memcpy(dst, format->literals + op->literal_pos, op->literal_len);
+            dst += op->literal_len;
+            break;
+        case STRAP_TIME_OP_SPACE:
+            *dst++ = ' ';
+            break;
+        case STRAP_TIME_OP_WEEKDAY_NAME:
+            memcpy(dst, strap_weekday_names + ((days % 7 + 11) % 7) * 3, 3);
+            dst += 3;
+            break;
+        case STRAP_TIME_OP_MONTH_NAME:
+            memcpy(dst, strap_month_names + (month - 1) * 3, 3);
+            dst += 3;
+            break;
+        case STRAP_TIME_OP_MONTH:
+            dst = strap_write_2digits(dst, month);
+            break;
+        case STRAP_TIME_OP_DAY:
+            dst = strap_write_2digits(dst, day);
+            break;
+        case STRAP_TIME_OP_DAY_SPACE:
+            dst = strap_write_2digits(dst, day);
+            if (day < 10)
+                dst[-2] = ' ';
+            break;
+        case STRAP_TIME_OP_YEAR:
+            dst = strap_write_2digits(dst, (unsigned)year / 100);
+            dst = strap_write_2digits(dst, (unsigned)year % 100);
+            break;
+        case STRAP_TIME_OP_YEAR2:
+            dst = strap_write_2digits(dst, (unsigned)year % 100);
+            break;
+        case STRAP_TIME_OP_HOUR:
+            dst = strap_write_2digits(dst, day_seconds / 3600);
+            break;
+        case STRAP_TIME_OP_MINUTE:
+            dst = strap_write_2digits(dst, day_seconds / 60 % 60);
+            break;
+        case STRAP_TIME_OP_SECOND:
+            dst = strap_write_2digits(dst, day_seconds % 60);
+            break;
+        case STRAP_TIME_OP_FRACTION:
+            dst = strap_write_2digits(dst, (unsigned)t.tv_usec / 10000);
+            dst = strap_write_2digits(dst, (unsigned)t.tv_usec / 100 % 100);
+            dst = strap_write_2digits(dst, (unsigned)t.tv_usec % 100);
+            break;
+        case STRAP_TIME_OP_OFFSET:
+        {
+            unsigned total = (unsigned)(offset_minutes < 0 ? -offset_minutes : offset_minutes);
+            *dst++ = offset_minutes < 0 ? '-' : '+';
+            dst = strap_write_2digits(dst, total / 60);
+            dst = strap_write_2digits(dst, total % 60);
+            break;
+        }
+        default:
+            break;
+        }
     }
 
+    *dst = '\0';
     strap_clear_error();
-    return 0;
+    return (int)(dst - buf);
 }
 
-int strap_time_local_offset(time_t when, int *offset_minutes)
+/* Profiling timers */
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#    define STRAP_HAVE_RDTSC 1
+#else
+#    define STRAP_HAVE_RDTSC 0
+#endif
+
+/* Calibration runs once; the published pointer guards the value. */
+static double strap_timer_scale_value = 1.0;
+static void *volatile strap_timer_scale = NULL;
+static strap_mutex_t strap_timer_scale_lock = STRAP_MUTEX_INIT;
+
+struct strap_timer_region
 {
-    if (!offset_minutes)
-    {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return -1;
-    }
+    const char *key;
+    char *name;
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
 
-    struct tm local_tm;
-    if (strap_localtime_safe(when, &local_tm) != 0)
-    {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return -1;
-    }
+/* Regions are recorded per thread, so the hot path takes no locks. */
+struct strap_timer_table
+{
+    size_t count;
+    size_t capacity;
+    struct strap_timer_region *regions;
+};
 
-    int64_t offset_seconds;
+static STRAP_THREAD_LOCAL struct strap_timer_table strap_timer_table = {0, 0, NULL};
 
-#if STRAP_HAVE_TM_GMTOFF
-    offset_seconds = (int64_t)local_tm.tm_gmtoff;
+int64_t strap_timer_now_ns(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (int64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000 +
+           (int64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
 #else
-    struct tm probe = local_tm;
-    time_t local_epoch = mktime(&probe);
-    if (local_epoch == (time_t)-1)
-    {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-        return -1;
-    }
-    offset_seconds = (int64_t)local_epoch - (int64_t)when;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 #endif
+}
 
-    if (offset_seconds < -14LL * 3600 || offset_seconds > 14LL * 3600)
-    {
-        errno = ERANGE;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return -1;
+uint64_t strap_timer_ticks(void)
+{
+#if STRAP_HAVE_RDTSC && defined(_MSC_VER)
+    return __rdtsc();
+#elif STRAP_HAVE_RDTSC
+    return __builtin_ia32_rdtsc();
+#else
+    return (uint64_t)strap_timer_now_ns();
+#endif
+}
+
+/* Measures the tick rate against the monotonic clock over a few
+ * milliseconds. */
+static const double *strap_timer_scale_get(void)
+{
+    const double *scale = strap_atomic_load_ptr(&strap_timer_scale);
+    if (scale)
+        return scale;
+
+    strap_mutex_lock(&strap_timer_scale_lock);
+    scale = strap_atomic_load_ptr(&strap_timer_scale);
+    if (!scale)
+    {
+#if STRAP_HAVE_RDTSC
+        int64_t start_ns = strap_timer_now_ns();
+        uint64_t start_ticks = strap_timer_ticks();
+        int64_t end_ns;
+        do
+            end_ns = strap_timer_now_ns();
+        while (end_ns - start_ns < 5000000);
+        uint64_t end_ticks = strap_timer_ticks();
+        if (end_ticks > start_ticks)
+            strap_timer_scale_value = (double)(end_ns - start_ns) / (double)(end_ticks - start_ticks);
+#endif
+        strap_atomic_store_ptr(&strap_timer_scale, &strap_timer_scale_value);
+        scale = &strap_timer_scale_value;
     }
+    strap_mutex_unlock(&strap_timer_scale_lock);
+    return scale;
+}
 
-    if (offset_seconds % 60 != 0)
+int strap_timer_calibrate(void)
+{
+    strap_timer_scale_get();
+    strap_clear_error();
+    return 0;
+}
+
+double strap_timer_ns_per_tick(void)
+{
+    return *strap_timer_scale_get();
+}
+
+int64_t strap_timer_ticks_to_ns(uint64_t ticks)
+{
+    return (int64_t)((double)ticks * *strap_timer_scale_get());
+}
+
+void strap_timer_start(strap_timer_t *timer)
+{
+    if (timer)
+        timer->start = strap_timer_ticks();
+}
+
+int64_t strap_timer_elapsed_ns(const strap_timer_t *timer)
+{
+    if (!timer)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
+    return strap_timer_ticks_to_ns(strap_timer_ticks() - timer->start);
+}
 
-    int candidate = (int)(offset_seconds / 60);
-    if ((int64_t)candidate != offset_seconds / 60)
+/* The region last opened through the caller's name pointer is checked
+ * first; the pointer only picks the candidate, since a reused buffer may
+ * now hold another name. */
+static size_t strap_timer_region_find(const char *name)
+{
+    struct strap_timer_table *table = &strap_timer_table;
+    for (size_t i = 0; i < table->count; ++i)
     {
-        errno = ERANGE;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return -1;
+        if (table->regions[i].key == name && strcmp(table->regions[i].name, name) == 0)
+            return i;
     }
-
-    *offset_minutes = candidate;
-    strap_clear_error();
-    return 0;
+    for (size_t i = 0; i < table->count; ++i)
+    {
+        if (strcmp(table->regions[i].name, name) == 0)
+        {
+            table->regions[i].key = name;
+            return i;
+        }
+    }
+    return SIZE_MAX;
 }
 
-int strap_time_format_iso8601_local(struct timeval t, char *buf, size_t bufsize)
+int strap_timer_region_begin(strap_timer_scope_t *scope, const char *name)
 {
-    int offset_minutes;
-    if (strap_time_local_offset(t.tv_sec, &offset_minutes) != 0)
+    if (!scope || !name)
+    {
+        errno = EINVAL;
+        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
-    return strap_time_format_iso8601(t, offset_minutes, buf, bufsize);
-}
+    }
 
-static int strap_parse_fixed_digits(const char **cursor, size_t count, int *out_value)
-{
-    int value = 0;
-    const char *p = *cursor;
-    for (size_t i = 0; i < count; ++i)
+    struct strap_timer_table *table = &strap_timer_table;
+    size_t slot = strap_timer_region_find(name);
+    if (slot == SIZE_MAX)
     {
-        if (!isdigit((unsigned char)p[i]))
+        if (table->count == table->capacity)
+        {
+            size_t capacity = table->capacity ? table->capacity * 2 : 16;
+            struct strap_timer_region *regions = strap_mem_realloc(table->regions, capacity * sizeof(*regions));
+            if (!regions)
+            {
+                scope->slot = SIZE_MAX;
+                errno = ENOMEM;
+                strap_set_error(STRAP_ERR_ALLOC);
+                return -1;
+            }
+            table->regions = regions;
+            table->capacity = capacity;
+            strap_thread_exit_arm();
+        }
+
+        char *copy = strap_mem_strdup(name);
+        if (!copy)
+        {
+            scope->slot = SIZE_MAX;
+            errno = ENOMEM;
+            strap_set_error(STRAP_ERR_ALLOC);
             return -1;
-        value = value * 10 + (p[i] - '0');
+        }
+
+        slot = table->count++;
+        struct strap_timer_region *region = &table->regions[slot];
+        region->key = name;
+        region->name = copy;
+        region->count = 0;
+        region->total = 0;
+        region->min = UINT64_MAX;
+        region->max = 0;
     }
-    *cursor = p + count;
-    *out_value = value;
+
+    scope->slot = slot;
+    scope->start = strap_timer_ticks();
     return 0;
 }
 
-int strap_time_parse_iso8601(const char *str, struct timeval *out, int *offset_minutes)
+int64_t strap_timer_region_end(strap_timer_scope_t *scope)
 {
-    if (!str || !out)
+    uint64_t end = strap_timer_ticks();
+    if (!scope || scope->slot >= strap_timer_table.count)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    const char *p = str;
-    int year, month, day, hour, minute, second;
+    uint64_t elapsed = end - scope->start;
+    struct strap_timer_region *region = &strap_timer_table.regions[scope->slot];
+    region->count++;
+    region->total += elapsed;
+    if (elapsed < region->min)
+        region->min = elapsed;
+    if (elapsed > region->max)
+        region->max = elapsed;
+
+    scope->slot = SIZE_MAX;
+    return strap_timer_ticks_to_ns(elapsed);
+}
+
+static void strap_timer_region_fill(const struct strap_timer_region *region, strap_timer_stats_t *out)
+{
+    out->count = region->count;
+    out->total_ns = strap_timer_ticks_to_ns(region->total);
+    out->min_ns = region->count ? strap_timer_ticks_to_ns(region->min) : 0;
+    out->max_ns = strap_timer_ticks_to_ns(region->max);
+}
 
-    if (strap_parse_fixed_digits(&p, 4, &year) != 0 || *p++ != '-' ||
-        strap_parse_fixed_digits(&p, 2, &month) != 0 || *p++ != '-' ||
-        strap_parse_fixed_digits(&p, 2, &day) != 0)
+int strap_timer_region_stats(const char *name, strap_timer_stats_t *out)
+{
+    if (!name || !out)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    if (*p != 'T' && *p != 't' && *p != ' ')
+    size_t slot = strap_timer_region_find(name);
+    if (slot == SIZE_MAX)
     {
-        errno = EINVAL;
+        errno = ENOENT;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
-    ++p;
 
-    if (strap_parse_fixed_digits(&p, 2, &hour) != 0 || *p++ != ':' ||
-        strap_parse_fixed_digits(&p, 2, &minute) != 0 || *p++ != ':' ||
-        strap_parse_fixed_digits(&p, 2, &second) != 0)
+    strap_timer_region_fill(&strap_timer_table.regions[slot], out);
+    strap_clear_error();
+    return 0;
+}
+
+void strap_timer_reset(void)
+{
+    struct strap_timer_table *table = &strap_timer_table;
+    for (size_t i = 0; i < table->count; ++i)
+        strap_free(table->regions[i].name);
+    strap_free(table->regions);
+    table->regions = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
+
+int strap_timer_report_text(FILE *out)
+{
+    if (!out)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    int micro = 0;
-    if (*p == '.' || *p == ',')
+    int rc = fprintf(out, "%-32s %12s %14s %12s %12s %12s\n", "region", "count", "total ms", "avg ns", "min ns", "max ns");
+    for (size_t i = 0; i < strap_timer_table.count && rc >= 0; ++i)
     {
-        ++p;
-        const char *frac_start = p;
-        size_t digits = 0;
-        int value = 0;
-        while (isdigit((unsigned char)*p) && digits < 6)
-        {
-            value = value * 10 + (*p - '0');
-            ++p;
-            ++digits;
-        }
-
-        if (!isdigit((unsigned char)*frac_start) || digits == 0)
-        {
-            errno = EINVAL;
-            strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-            return -1;
-        }
-
-        if (isdigit((unsigned char)*p))
-        {
-            errno = EINVAL;
-            strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
-            return -1;
-        }
-
-        while (digits++ < 6)
-            value *= 10;
-        micro = value;
+        strap_timer_stats_t stats;
+        strap_timer_region_fill(&strap_timer_table.regions[i], &stats);
+        rc = fprintf(out, "%-32s %12llu %14.3f %12lld %12lld %12lld\n",
+                     strap_timer_table.regions[i].name,
+                     (unsigned long long)stats.count,
+                     (double)stats.total_ns / 1000000.0,
+                     (long long)(stats.count ? stats.total_ns / (int64_t)stats.count : 0),
+                     (long long)stats.min_ns,
+                     (long long)stats.max_ns);
     }
 
-    if (*p == '\0')
+    if (rc < 0)
     {
-        errno = EINVAL;
-        strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
+        strap_set_error(STRAP_ERR_IO);
         return -1;
     }
+    strap_clear_error();
+    return 0;
+}
 
-    int parsed_offset;
-    if (strap_time_parse_tz_offset(p, &parsed_offset) != 0)
+static int strap_timer_write_json_string(FILE *out, const char *s)
+{
+    if (fputc('"', out) == EOF)
         return -1;
+    for (; *s; ++s)
+    {
+        unsigned char ch = (unsigned char)*s;
+        int rc;
+        if (ch == '"' || ch == '\\')
+            rc = fprintf(out, "\\%c", ch);
+        else if (ch < 0x20)
+            rc = fprintf(out, "\\u%04x", ch);
+        else
+            rc = fputc(ch, out) == EOF ? -1 : 0;
+        if (rc < 0)
+            return -1;
+    }
+    return fputc('"', out) == EOF ? -1 : 0;
+}
 
-    struct tm tm_local;
-    memset(&tm_local, 0, sizeof(tm_local));
-    tm_local.tm_year = year - 1900;
-    tm_local.tm_mon = month - 1;
-    tm_local.tm_mday = day;
-    tm_local.tm_hour = hour;
-    tm_local.tm_min = minute;
-    tm_local.tm_sec = second;
-
-    int64_t local_seconds;
-    if (strap_tm_to_epoch(&tm_local, &local_seconds) != 0)
+int strap_timer_report_json(FILE *out)
+{
+    if (!out)
     {
         errno = EINVAL;
         strap_set_error(STRAP_ERR_INVALID_ARGUMENT);
         return -1;
     }
 
-    int64_t utc_seconds;
-    if (strap_apply_offset(local_seconds, -parsed_offset, &utc_seconds) != 0)
+    int rc = fputs("{\"regions\":[", out) == EOF ? -1 : 0;
+    for (size_t i = 0; i < strap_timer_table.count && rc >= 0; ++i)
     {
-        errno = ERANGE;
-        strap_set_error(STRAP_ERR_OVERFLOW);
-        return -1;
+        strap_timer_stats_t stats;
+        strap_timer_region_fill(&strap_timer_table.regions[i], &stats);
+        rc = fputs(i ? ",{\"name\":" : "{\"name\":", out) == EOF ? -1 : 0;
+        if (rc >= 0)
+            rc = strap_timer_write_json_string(out, strap_timer_table.regions[i].name);
+        if (rc >= 0)
+            rc = fprintf(out, ",\"count\":%llu,\"total_ns\":%lld,\"min_ns\":%lld,\"max_ns\":%lld}",
+                         (unsigned long long)stats.count,
+                         (long long)stats.total_ns,
+                         (long long)stats.min_ns,
+                         (long long)stats.max_ns);
     }
+    if (rc >= 0)
+        rc = fputs("]}\n", out) == EOF ? -1 : 0;
 
-    time_t utc_time = (time_t)utc_seconds;
-    if ((int64_t)utc_time != utc_seconds)
+    if (rc < 0)
     {
-        errno = ERANGE;
-        strap_set_error(STRAP_ERR_OVERFLOW);
+        strap_set_error(STRAP_ERR_IO);
         return -1;
     }
-
-    out->tv_sec = utc_time;
-    out->tv_usec = micro;
-
-    if (offset_minutes)
-        *offset_minutes = parsed_offset;
-
     strap_clear_error();
     return 0;
 }
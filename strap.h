@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <time.h>
 
@@ -23,11 +24,34 @@ typedef enum
 } strap_error_t;
 
 typedef struct strap_arena strap_arena_t;
+typedef struct strap_locale strap_locale_t;
+typedef struct strap_tz strap_tz_t;
+
+/* Borrowed string that need not be NUL-terminated. */
+typedef struct
+{
+    const char *ptr;
+    size_t len;
+} strap_str_view_t;
 
 strap_error_t strap_last_error(void);
 const char *strap_error_string(strap_error_t err);
 void strap_clear_error(void);
 
+/* Allocator hooks. Every heap buffer STRAP returns or keeps internally comes
+ * from these; release returned buffers with strap_free(). Install the hooks
+ * once, before any other STRAP call. */
+typedef struct
+{
+    void *(*malloc_fn)(size_t size, void *ctx);
+    void *(*realloc_fn)(void *ptr, size_t size, void *ctx);
+    void (*free_fn)(void *ptr, void *ctx);
+    void *ctx;
+} strap_allocator_t;
+
+int strap_set_allocator(const strap_allocator_t *allocator); /* NULL restores malloc/realloc/free */
+void strap_free(void *ptr);
+
 /* Safe reading */
 char *afgets(FILE *f);                  /* reads a complete line, returns malloc() buffer or NULL */
 char *afread(FILE *f, size_t *out_len); /* reads entire file into heap, returns buffer and length */
@@ -54,6 +78,26 @@ int strcoll_locale(const char *a, const char *b, const char *locale_name);
 int strcasecmp_locale(const char *a, const char *b, const char *locale_name);
 int strap_strcasecmp(const char *a, const char *b); /* ASCII-only, portable */
 bool strcaseeq(const char *a, const char *b);
+int strap_strcasecmp_n(const char *a, size_t a_len, const char *b, size_t b_len); /* ASCII-only, length-aware */
+bool strcaseeq_n(const char *a, size_t a_len, const char *b, size_t b_len);
+uint64_t strap_hash_ci(const char *s, size_t len); /* ASCII case-insensitive, consistent with strcaseeq_n */
+
+/* Locale handles (reusable across calls; named entry points share an internal cache) */
+strap_locale_t *strap_locale_open(const char *locale_name); /* NULL or "" selects the process locale */
+void strap_locale_close(strap_locale_t *locale);
+char *strtolower_locale_handle(const char *s, const strap_locale_t *locale); /* malloc() */
+char *strtoupper_locale_handle(const char *s, const strap_locale_t *locale); /* malloc() */
+int strcoll_locale_handle(const char *a, const char *b, const strap_locale_t *locale);
+int strcasecmp_locale_handle(const char *a, const char *b, const strap_locale_t *locale);
+
+/* Collation: transform each string once, then compare keys with memcmp()/strcmp() */
+int strap_sort_locale(char **strs, size_t n, const char *locale_name); /* sorts the pointer array in place */
+int strap_sort_locale_handle(char **strs, size_t n, const strap_locale_t *locale);
+
+/* UTF-8 case mapping (Unicode simple mappings, locale-independent) */
+char *strap_utf8_casefold(const char *s); /* malloc(), for case-insensitive matching */
+char *strap_utf8_tolower(const char *s);  /* malloc() */
+char *strap_utf8_toupper(const char *s);  /* malloc() */
 
 typedef bool (*strap_split_predicate_fn)(unsigned char ch, void *userdata);
 
@@ -71,27 +115,244 @@ void strtrim_inplace(char *s); /* modifies buffer in-place */
 char *strtrim_arena(strap_arena_t *arena, const char *s);
 
 /* Arena allocator */
+typedef struct
+{
+    size_t block_size;      /* first block size; 0 selects 4096 */
+    size_t max_block_size;  /* cap for geometric growth; 0 keeps block_size */
+    unsigned growth_factor; /* multiplier applied per new block; 0 or 1 disables growth */
+    size_t alignment;       /* default allocation alignment, a power of two; 0 selects sizeof(void *) */
+    size_t vm_reserve;      /* reserve one contiguous virtual range of this size, committed on demand; 0 disables */
+    bool huge_pages;        /* with vm_reserve: align the range and request transparent huge pages */
+    bool decommit_on_clear; /* with vm_reserve: return committed pages to the system on clear */
+} strap_arena_options_t;
+
+typedef struct
+{
+    size_t block_count;             /* regular and oversized blocks */
+    size_t bytes_reserved;          /* total block capacity */
+    size_t bytes_used;              /* live allocations, including alignment padding */
+    size_t bytes_alignment_padding; /* padding added by allocations since creation or reset */
+    size_t bytes_tail_waste;        /* unused tails of blocks the cursor has moved past */
+    size_t high_water_mark;         /* peak bytes_used since creation or reset */
+    size_t oversized_allocs;        /* side-block allocations since creation or reset */
+} strap_arena_stats_t;
+
+/* Called whenever the arena mallocs a new block. */
+typedef void (*strap_arena_block_fn)(size_t block_size, bool oversized, void *userdata);
+
+/* A mark stays valid until the arena is cleared, trimmed of a block, or
+ * rewound to an earlier mark; rewinding to a stale mark fails with EINVAL
+ * when the arena was cleared or trimmed since. */
+typedef struct
+{
+    void *block; /* opaque */
+    size_t used;
+    void *oversized; /* opaque */
+    size_t generation;
+} strap_arena_mark_t;
+
 strap_arena_t *strap_arena_create(size_t block_size);
+void strap_arena_options_init(strap_arena_options_t *options);
+strap_arena_t *strap_arena_create_ex(const strap_arena_options_t *options);
 void strap_arena_destroy(strap_arena_t *arena);
-void strap_arena_clear(strap_arena_t *arena);
+void strap_arena_clear(strap_arena_t *arena); /* keeps blocks for reuse */
+size_t strap_arena_trim(strap_arena_t *arena, size_t keep_bytes); /* frees empty blocks, returns bytes released */
 void *strap_arena_alloc(strap_arena_t *arena, size_t size);
+void *strap_arena_alloc_aligned(strap_arena_t *arena, size_t size, size_t alignment); /* power-of-two alignment */
+void *strap_arena_realloc(strap_arena_t *arena, void *ptr, size_t old_size, size_t new_size); /* grows the last allocation in place */
+strap_arena_mark_t strap_arena_mark(const strap_arena_t *arena);      /* savepoint for scoped scratch */
+void strap_arena_rewind(strap_arena_t *arena, strap_arena_mark_t mark); /* frees everything after mark */
+int strap_arena_stats(const strap_arena_t *arena, strap_arena_stats_t *out);
+void strap_arena_stats_reset(strap_arena_t *arena); /* restarts high-water mark and counters */
+void strap_arena_set_block_callback(strap_arena_t *arena, strap_arena_block_fn callback, void *userdata);
 char *strap_arena_strdup(strap_arena_t *arena, const char *s);
 char *strap_arena_strndup(strap_arena_t *arena, const char *s, size_t n);
+
 char *strjoin_arena(strap_arena_t *arena, const char **parts, size_t nparts, const char *sep);
 char *strreplace_arena(strap_arena_t *arena, const char *s, const char *search, const char *replacement);
 char *strtolower_locale_arena(strap_arena_t *arena, const char *s, const char *locale_name);
 char *strtoupper_locale_arena(strap_arena_t *arena, const char *s, const char *locale_name);
+char *strtolower_locale_handle_arena(strap_arena_t *arena, const char *s, const strap_locale_t *locale);
+char *strtoupper_locale_handle_arena(strap_arena_t *arena, const char *s, const strap_locale_t *locale);
+char *strap_collate_key(strap_arena_t *arena, const char *s, const char *locale_name, size_t *out_len);
+char *strap_collate_key_handle(strap_arena_t *arena, const char *s, const strap_locale_t *locale, size_t *out_len);
+char *strap_utf8_casefold_arena(strap_arena_t *arena, const char *s);
+char *strap_utf8_tolower_arena(strap_arena_t *arena, const char *s);
+char *strap_utf8_toupper_arena(strap_arena_t *arena, const char *s);
+
+/* Arena shared by several threads. Allocation is thread-safe and lock-free
+ * while the current block has room; clear and destroy need exclusive use. */
+typedef struct strap_concurrent_arena strap_concurrent_arena_t;
+
+strap_concurrent_arena_t *strap_concurrent_arena_create(size_t block_size);
+void strap_concurrent_arena_destroy(strap_concurrent_arena_t *arena);
+void strap_concurrent_arena_clear(strap_concurrent_arena_t *arena); /* single owner; keeps blocks */
+void *strap_concurrent_arena_alloc(strap_concurrent_arena_t *arena, size_t size);
+char *strap_concurrent_arena_strdup(strap_concurrent_arena_t *arena, const char *s);
+
+/* Pool of reusable arenas. Acquire returns a cleared arena; release clears
+ * it and keeps it warm, first in a one-slot per-thread cache and then in a
+ * shared list. Block memory kept in either is capped at max_retained_bytes;
+ * arenas that do not fit after trimming are destroyed instead.
+ * A thread's slot goes back to its pool when the thread exits or releases
+ * to another pool, and is freed if that pool has been destroyed; passing
+ * NULL to the flush does the same for whatever pool the slot belongs to. */
+typedef struct strap_arena_pool strap_arena_pool_t;
+
+strap_arena_pool_t *strap_arena_pool_create(const strap_arena_options_t *options, size_t max_retained_bytes);
+void strap_arena_pool_destroy(strap_arena_pool_t *pool);
+strap_arena_t *strap_arena_pool_acquire(strap_arena_pool_t *pool);
+void strap_arena_pool_release(strap_arena_pool_t *pool, strap_arena_t *arena);
+void strap_arena_pool_flush_thread_cache(strap_arena_pool_t *pool);
+size_t strap_arena_pool_retained(strap_arena_pool_t *pool); /* bytes held by the pool and thread slots */
+
+/* Slab allocator for small, individually freed strings. Requests up to 256
+ * bytes come from 16/32/64/128/256-byte size classes with per-thread free
+ * lists; larger ones fall back to the allocator hooks. Free objects with
+ * strap_slab_free() on the same slab. A thread's cached objects go back to
+ * the slab when the thread exits or moves on to other slabs. Destroying the
+ * slab reclaims every small object at once; large ones must be freed first. */
+typedef struct strap_slab strap_slab_t;
+
+strap_slab_t *strap_slab_create(void);
+void strap_slab_destroy(strap_slab_t *slab);
+void *strap_slab_alloc(strap_slab_t *slab, size_t size);
+void strap_slab_free(strap_slab_t *slab, void *ptr);
+void strap_slab_flush_thread_cache(strap_slab_t *slab); /* returns this thread's cached objects */
+char *strap_slab_strdup(strap_slab_t *slab, const char *s);
+char *strjoin_slab(strap_slab_t *slab, const char **parts, size_t nparts, const char *sep);
+char *strtrim_slab(strap_slab_t *slab, const char *s);
+char **strsplit_limit_slab(strap_slab_t *slab, const char *s, const char *delim, size_t max_splits, size_t *out_count);
+char **strsplit_predicate_slab(strap_slab_t *slab,
+                               const char *s,
+                               strap_split_predicate_fn predicate,
+                               void *userdata,
+                               size_t max_splits,
+                               size_t *out_count);
+void strsplit_free_slab(strap_slab_t *slab, char **tokens); /* tokens from the slab, array from the heap */
 
 /* Time utilities (struct timeval) */
 struct timeval timeval_add(struct timeval a, struct timeval b);
 struct timeval timeval_sub(struct timeval a, struct timeval b);
 double timeval_to_seconds(struct timeval t);
 struct timeval timeval_add_minutes(struct timeval t, int minutes);
+
+/* Nanosecond counterparts (struct timespec, int64_t nanoseconds). */
+struct timespec timespec_add(struct timespec a, struct timespec b);
+struct timespec timespec_sub(struct timespec a, struct timespec b);
+int64_t timespec_to_ns(struct timespec t);
+struct timespec timespec_from_ns(int64_t ns);
+struct timeval timespec_to_timeval(struct timespec t); /* truncates to microseconds */
+struct timespec timeval_to_timespec(struct timeval t);
 int strap_time_offset_to_string(int offset_minutes, char *buf, size_t bufsize);
 int strap_time_parse_tz_offset(const char *str, int *offset_minutes);
 int strap_time_format_iso8601(struct timeval t, int offset_minutes, char *buf, size_t bufsize);
+int strap_time_write_iso8601(struct timeval t, int offset_minutes, char *buf, size_t bufsize); /* returns length or -1 */
 int strap_time_parse_iso8601(const char *str, struct timeval *out, int *offset_minutes);
+/* Fractions print as 6 digits for whole microseconds, otherwise 9; parsing
+ * accepts 1 to 9 digits. */
+int strap_time_write_iso8601_ns(struct timespec t, int offset_minutes, char *buf, size_t bufsize); /* returns length or -1 */
+int strap_time_parse_iso8601_ns(const char *str, struct timespec *out, int *offset_minutes);
+/* Column-at-a-time parsing. out_us receives UTC microseconds since the
+ * epoch and out_offsets (optional) the offset in minutes; out_status
+ * (optional) receives a strap_error_t per element, and failed elements are
+ * zeroed. Returns 0 when every element parsed, otherwise -1 with the first
+ * failure as the error state. No state is shared between calls, so disjoint
+ * ranges of a column can be parsed on different threads. */
+int strap_time_parse_iso8601_batch(const char *const *strs, size_t n, int64_t *out_us, int16_t *out_offsets, uint8_t *out_status);
+int strap_time_parse_iso8601_batch_views(const strap_str_view_t *views, size_t n, int64_t *out_us, int16_t *out_offsets, uint8_t *out_status);
 int strap_time_local_offset(time_t when, int *offset_minutes);
 int strap_time_format_iso8601_local(struct timeval t, char *buf, size_t bufsize);
+/* The local zone's TZif transitions are loaded once and searched without
+ * locking; call after changing TZ or the system zone to pick it up. */
+int strap_time_local_reload(void);
+
+/* Named zones from the system zoneinfo database ($TZDIR or
+ * /usr/share/zoneinfo). Tables are cached for the lifetime of the process
+ * and are safe to share between threads; do not free them. */
+const strap_tz_t *strap_tz_load(const char *name); /* "Area/City" */
+const char *strap_tz_name(const strap_tz_t *tz);
+int strap_tz_offset(const strap_tz_t *tz, time_t when, int *offset_minutes);
+/* `local` counts wall-clock seconds since 1970-01-01T00:00:00 in the zone.
+ * Ambiguous times resolve to the earlier instant; times skipped by a
+ * transition are moved forward past it. */
+int strap_tz_local_to_utc(const strap_tz_t *tz, time_t local, time_t *out);
+int strap_time_format_iso8601_tz(struct timeval t, const strap_tz_t *tz, char *buf, size_t bufsize);
+int strap_time_now_coarse(struct timeval *out); /* CLOCK_REALTIME_COARSE where available */
+
+/* Caches the formatted `YYYY-MM-DDTHH:MM:` prefix and the offset suffix of
+ * the last minute seen, so repeated timestamps only patch the seconds and
+ * fraction. Output matches strap_time_write_iso8601(). Not thread-safe; keep
+ * one per thread. */
+typedef struct
+{
+    int64_t minute; /* UTC minute of the cached prefix; INT64_MIN when empty */
+    int offset_minutes;
+    bool local; /* offset follows the local zone */
+    char prefix[17];
+    char suffix[7];
+    size_t suffix_len;
+} strap_time_formatter_t;
+
+int strap_time_formatter_init(strap_time_formatter_t *formatter, int offset_minutes);
+int strap_time_formatter_init_local(strap_time_formatter_t *formatter);
+int strap_time_formatter_format(strap_time_formatter_t *formatter, struct timeval t, char *buf, size_t bufsize); /* returns length or -1 */
+int strap_time_formatter_format_now(strap_time_formatter_t *formatter, char *buf, size_t bufsize);
+
+/* strptime/strftime-style formats compiled once into a small program.
+ * Supported: %a %b (English names) %m %d %e %Y %y %H %M %S %f
+ * (microseconds) %z (+HHMM; parsing also takes Z and +HH:MM) and %%.
+ * Whitespace in the format matches any run of spaces or tabs. Fields the
+ * format lacks default to 1970-01-01T00:00:00 UTC. Parsing stops at the end
+ * of the format and returns the bytes consumed, so trailing text is left
+ * to the caller. A compiled format may be shared between threads. */
+typedef struct strap_time_format strap_time_format_t;
+
+strap_time_format_t *strap_time_format_compile(const char *fmt);
+void strap_time_format_free(strap_time_format_t *format);
+int strap_time_format_parse(const strap_time_format_t *format, const char *str, struct timeval *out, int *offset_minutes); /* returns bytes consumed or -1 */
+int strap_time_format_write(const strap_time_format_t *format, struct timeval t, int offset_minutes, char *buf, size_t bufsize); /* returns length or -1 */
+
+/* Profiling timers. Ticks come from the TSC on x86 and from the monotonic
+ * clock elsewhere; the tick rate is calibrated against CLOCK_MONOTONIC once,
+ * on first conversion or by strap_timer_calibrate(). */
+int64_t strap_timer_now_ns(void); /* CLOCK_MONOTONIC */
+uint64_t strap_timer_ticks(void);
+int strap_timer_calibrate(void);
+double strap_timer_ns_per_tick(void);
+int64_t strap_timer_ticks_to_ns(uint64_t ticks);
+
+typedef struct
+{
+    uint64_t start;
+} strap_timer_t;
+
+void strap_timer_start(strap_timer_t *timer);
+int64_t strap_timer_elapsed_ns(const strap_timer_t *timer);
+
+/* Named regions accumulate count, total, min and max into a table owned by
+ * the calling thread. Pair every begin with an end on the same thread;
+ * regions may nest. Reports cover the calling thread only; a thread's table
+ * is freed when it exits or calls strap_timer_reset(). */
+typedef struct
+{
+    size_t slot;
+    uint64_t start;
+} strap_timer_scope_t;
+
+typedef struct
+{
+    uint64_t count;
+    int64_t total_ns;
+    int64_t min_ns;
+    int64_t max_ns;
+} strap_timer_stats_t;
+
+int strap_timer_region_begin(strap_timer_scope_t *scope, const char *name);
+int64_t strap_timer_region_end(strap_timer_scope_t *scope); /* returns elapsed ns or -1 */
+int strap_timer_region_stats(const char *name, strap_timer_stats_t *out);
+int strap_timer_report_text(FILE *out);
+int strap_timer_report_json(FILE *out);
+void strap_timer_reset(void);
 
 #endif /* STRAP_H */
@@ -5,6 +5,13 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <ctype.h>
+
+#if defined(_WIN32)
+#    include <windows.h>
+#else
+#    include <pthread.h>
+#endif
 
 void test_strtrim()
 {
@@ -383,9 +390,91 @@ void test_strcasecmp_helpers()
     assert(cmp == 0);
     assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
 
+    /* Every length and mismatch position, with strings ending just short
+     * of a page boundary, agrees with a bytewise fold. */
+    static char pages[3 * 4096];
+    char *edge = (char *)(((uintptr_t)pages + 2 * 4096) & ~(uintptr_t)4095);
+    for (size_t len = 0; len <= 24; ++len)
+    {
+        char *a = edge - len - 1;
+        char *b = edge - 4096 + 8 + (len % 5);
+        for (size_t at = 0; at <= len; ++at)
+        {
+            for (size_t i = 0; i < len; ++i)
+            {
+                a[i] = (char)('A' + i % 26);
+                b[i] = (char)('a' + i % 26);
+            }
+            a[len] = '\0';
+            b[len] = '\0';
+            if (at < len)
+                b[at] = '[';
+            int expected = 0;
+            for (size_t i = 0; i <= len && expected == 0; ++i)
+            {
+                int ca = tolower((unsigned char)a[i]);
+                int cb = tolower((unsigned char)b[i]);
+                expected = ca - cb;
+                if (ca == 0)
+                    break;
+            }
+            int actual = strap_strcasecmp(a, b);
+            assert((actual < 0) == (expected < 0) && (actual > 0) == (expected > 0));
+            assert((strap_strcasecmp(b, a) < 0) == (expected > 0));
+            assert(strcaseeq(a, b) == (expected == 0));
+        }
+    }
+
     printf("strap_strcasecmp/strcaseeq tests passed\n");
 }
 
+void test_strcasecmp_n_and_hash()
+{
+    const char *upper = "CONTENT-TYPE: APPLICATION/JSON; CHARSET=UTF-8 [X-REQUEST-ID]";
+    const char *lower = "content-type: application/json; charset=utf-8 [x-request-id]";
+    size_t len = strlen(upper);
+
+    strap_clear_error();
+    assert(strcaseeq_n(upper, len, lower, len));
+    assert(strap_strcasecmp_n(upper, len, lower, len) == 0);
+    assert(strap_last_error() == STRAP_OK);
+
+    /* Length mismatch never compares equal. */
+    assert(!strcaseeq_n(upper, len, lower, len - 1));
+    assert(strap_strcasecmp_n(upper, len - 1, lower, len) < 0);
+    assert(strap_strcasecmp_n(upper, len, lower, len - 1) > 0);
+
+    /* Differences are reported at the first mismatching byte in every lane. */
+    char buf[64];
+    for (size_t i = 0; i < len; ++i)
+    {
+        memcpy(buf, lower, len);
+        buf[i] = '\x7f';
+        assert(!strcaseeq_n(upper, len, buf, len));
+        assert(strap_strcasecmp_n(upper, len, buf, len) < 0);
+        assert(strap_strcasecmp_n(buf, len, upper, len) > 0);
+    }
+
+    /* '@'/'`' and '['/'{' sit next to the letter ranges and must not fold. */
+    assert(!strcaseeq_n("@[", 2, "`{", 2));
+    assert(strap_strcasecmp("ABC[", "abc{") < 0);
+    assert(strcaseeq("Keep-Alive", "keep-alive"));
+    assert(!strcaseeq("Keep-Alive", "keep-alive "));
+
+    strap_clear_error();
+    assert(strap_hash_ci(upper, len) == strap_hash_ci(lower, len));
+    assert(strap_hash_ci("Host", 4) == strap_hash_ci("hOST", 4));
+    assert(strap_hash_ci("Host", 4) != strap_hash_ci("Hosts", 5));
+    assert(strap_hash_ci("", 0) == strap_hash_ci("", 0));
+    assert(strap_last_error() == STRAP_OK);
+
+    strap_clear_error();
+    assert(!strcaseeq_n(NULL, 0, "x", 1));
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("strap_strcasecmp_n/strcaseeq_n/strap_hash_ci tests passed\n");
+}
+
 void test_timeval()
 {
     struct timeval a = {1, 500000};
@@ -402,6 +491,66 @@ void test_timeval()
     printf("timeval tests passed\n");
 }
 
+void test_timespec()
+{
+    struct timespec a = {1, 500000000};
+    struct timespec b = {2, 600000001};
+    struct timespec sum = timespec_add(a, b);
+    assert(sum.tv_sec == 4 && sum.tv_nsec == 100000001);
+
+    struct timespec diff = timespec_sub(a, b);
+    assert(diff.tv_sec == -2 && diff.tv_nsec == 899999999);
+
+    assert(timespec_to_ns(b) == 2600000001LL);
+    struct timespec back = timespec_from_ns(-1);
+    assert(back.tv_sec == -1 && back.tv_nsec == 999999999);
+    assert(timespec_to_ns(back) == -1);
+
+    struct timeval tv = timespec_to_timeval(b);
+    assert(tv.tv_sec == 2 && tv.tv_usec == 600000);
+    struct timespec ts = timeval_to_timespec(tv);
+    assert(ts.tv_sec == 2 && ts.tv_nsec == 600000000);
+
+    char buf[64];
+    struct timespec sample = {1715949296, 123456789};
+    assert(strap_time_write_iso8601_ns(sample, 120, buf, sizeof(buf)) == 35);
+    assert(strcmp(buf, "2024-05-17T14:34:56.123456789+02:00") == 0);
+    sample.tv_nsec = 123456000;
+    assert(strap_time_write_iso8601_ns(sample, 0, buf, sizeof(buf)) == 27);
+    assert(strcmp(buf, "2024-05-17T12:34:56.123456Z") == 0);
+    sample.tv_nsec = 0;
+    assert(strap_time_write_iso8601_ns(sample, 0, buf, sizeof(buf)) == 20);
+    assert(strcmp(buf, "2024-05-17T12:34:56Z") == 0);
+
+    /* Years past 9999 take the variable-width path, as for timevals. */
+    sample.tv_sec = 253402300800;
+    sample.tv_nsec = 5;
+    assert(strap_time_write_iso8601_ns(sample, 0, buf, sizeof(buf)) == 31);
+    assert(strcmp(buf, "10000-01-01T00:00:00.000000005Z") == 0);
+    sample.tv_nsec = 250000;
+    assert(strap_time_write_iso8601_ns(sample, 60, buf, sizeof(buf)) == 33);
+    assert(strcmp(buf, "10000-01-01T01:00:00.000250+01:00") == 0);
+    sample.tv_nsec = 1000000000;
+    strap_clear_error();
+    assert(strap_time_write_iso8601_ns(sample, 0, buf, sizeof(buf)) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    struct timespec parsed;
+    int offset = 0;
+    assert(strap_time_parse_iso8601_ns("2024-05-17T14:34:56.123456789+02:00", &parsed, &offset) == 0);
+    assert(parsed.tv_sec == 1715949296 && parsed.tv_nsec == 123456789 && offset == 120);
+    assert(strap_time_parse_iso8601_ns("2024-05-17T12:34:56.5Z", &parsed, NULL) == 0);
+    assert(parsed.tv_nsec == 500000000);
+    assert(strap_time_parse_iso8601_ns("2024-05-17T12:34:56.1234567890Z", &parsed, NULL) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    /* The microsecond parser still stops at six digits. */
+    struct timeval micro;
+    assert(strap_time_parse_iso8601("2024-05-17T12:34:56.1234567Z", &micro, NULL) == -1);
+
+    printf("timespec tests passed\n");
+}
+
 void test_locale_helpers()
 {
     strap_clear_error();
@@ -431,6 +580,170 @@ void test_locale_helpers()
     printf("locale helper tests passed\n");
 }
 
+void test_locale_handles()
+{
+    strap_clear_error();
+    strap_locale_t *c_locale = strap_locale_open("C");
+    assert(c_locale);
+    assert(strap_last_error() == STRAP_OK);
+
+    char *lower = strtolower_locale_handle("MiXeD", c_locale);
+    assert(lower && strcmp(lower, "mixed") == 0);
+    free(lower);
+
+    char *upper = strtoupper_locale_handle("MiXeD", c_locale);
+    assert(upper && strcmp(upper, "MIXED") == 0);
+    free(upper);
+
+    assert(strcasecmp_locale_handle("HeLLo", "hello", c_locale) == 0);
+    assert(strcoll_locale_handle("abc", "abd", c_locale) < 0);
+    strap_locale_close(c_locale);
+
+    /* Repeated named calls are served from the locale cache. */
+    for (int i = 0; i < 64; ++i)
+    {
+        strap_clear_error();
+        assert(strcasecmp_locale("ABC", "abc", "C") == 0);
+        assert(strcoll_locale("b", "a", "POSIX") > 0);
+        assert(strap_last_error() == STRAP_OK);
+    }
+
+    strap_clear_error();
+    strap_locale_t *invalid = strap_locale_open("xx_INVALID.locale");
+    assert(!invalid);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_clear_error();
+    char *failed = strtolower_locale("ABC", "xx_INVALID.locale");
+    assert(!failed);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_clear_error();
+    assert(strtolower_locale_handle("abc", NULL) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("locale handle tests passed\n");
+}
+
+void test_locale_case_tables()
+{
+    char input[301];
+    for (int i = 0; i < 300; ++i)
+        input[i] = (char)(i % 7 == 0 ? 0xC3 : 0x40 + (i % 60)); /* letters, punctuation, high bytes */
+    input[300] = '\0';
+
+    strap_clear_error();
+    char *lower = strtolower_locale(input, "C");
+    char *upper = strtoupper_locale(input, "C");
+    assert(lower && upper);
+    for (int i = 0; i < 300; ++i)
+    {
+        unsigned char ch = (unsigned char)input[i];
+        unsigned char expected_lower = (ch >= 'A' && ch <= 'Z') ? (unsigned char)(ch + 32) : ch;
+        unsigned char expected_upper = (ch >= 'a' && ch <= 'z') ? (unsigned char)(ch - 32) : ch;
+        assert((unsigned char)lower[i] == expected_lower);
+        assert((unsigned char)upper[i] == expected_upper);
+    }
+    assert(lower[300] == '\0' && upper[300] == '\0');
+    free(lower);
+    free(upper);
+
+    strap_clear_error();
+    assert(strcasecmp_locale("Header-Field-Name", "HEADER-FIELD-NAME", "C") == 0);
+    assert(strcasecmp_locale("abc", "ABD", "C") < 0);
+    assert(strcasecmp_locale("abcd", "ABC", "C") > 0);
+    assert(strap_last_error() == STRAP_OK);
+
+    printf("locale case table tests passed\n");
+}
+
+void test_collation_keys_and_sort()
+{
+    strap_arena_t *arena = strap_arena_create(0);
+    assert(arena);
+
+    const char *samples[] = {"delta", "Alpha", "charlie", "alpha", "bravo", "Bravo", "", "echo"};
+    const size_t count = sizeof(samples) / sizeof(samples[0]);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            strap_clear_error();
+            size_t len_a = 0, len_b = 0;
+            char *key_a = strap_collate_key(arena, samples[i], "C", &len_a);
+            char *key_b = strap_collate_key(arena, samples[j], "C", &len_b);
+            assert(key_a && key_b);
+            assert(strlen(key_a) == len_a && strlen(key_b) == len_b);
+            int by_key = strcmp(key_a, key_b);
+            int by_coll = strcoll_locale(samples[i], samples[j], "C");
+            assert((by_key < 0) == (by_coll < 0) && (by_key > 0) == (by_coll > 0));
+        }
+    }
+
+    char *strs[] = {"delta", "Alpha", "charlie", "alpha", "bravo", "Bravo", "", "echo"};
+    strap_clear_error();
+    assert(strap_sort_locale(strs, count, "C") == 0);
+    assert(strap_last_error() == STRAP_OK);
+    const char *expected[] = {"", "Alpha", "Bravo", "alpha", "bravo", "charlie", "delta", "echo"};
+    for (size_t i = 0; i < count; ++i)
+        assert(strcmp(strs[i], expected[i]) == 0);
+
+    strap_locale_t *locale = strap_locale_open(NULL);
+    assert(locale);
+    assert(strap_sort_locale_handle(strs, count, locale) == 0);
+    for (size_t i = 1; i < count; ++i)
+        assert(strcoll(strs[i - 1], strs[i]) <= 0);
+    strap_locale_close(locale);
+
+    strap_clear_error();
+    char *with_null[] = {"a", NULL};
+    assert(strap_sort_locale(with_null, 2, "C") == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_arena_destroy(arena);
+    printf("collation key and sort tests passed\n");
+}
+
+void test_utf8_case_mapping()
+{
+    strap_clear_error();
+    char *lower = strap_utf8_tolower("\xC3\x80\xC3\x89\xC3\x8E Stra\xC3\x9F\x65 \xD0\x9C\xD0\x9E\xD0\xA1\xD0\x9A\xD0\x92\xD0\x90");
+    assert(lower && strcmp(lower, "\xC3\xA0\xC3\xA9\xC3\xAE stra\xC3\x9F\x65 \xD0\xBC\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0") == 0);
+    assert(strap_last_error() == STRAP_OK);
+    free(lower);
+
+    /* Mappings that change the encoded length: dotless i -> I, U+023F -> U+2C7E. */
+    char *upper = strap_utf8_toupper("\xC4\xB1\xC8\xBFx");
+    assert(upper && strcmp(upper, "I\xE2\xB1\xBEX") == 0);
+    free(upper);
+
+    /* Case folding: Kelvin sign, final sigma and capital sharp s. */
+    char *folded = strap_utf8_casefold("\xE2\x84\xAA \xCE\xA3\xCE\xB9\xCF\x83\xCF\x85\xCF\x86\xCE\xBF\xCF\x82 \xE1\xBA\x9E");
+    char *folded_upper = strap_utf8_casefold("k \xCE\xA3\xCE\x99\xCE\xA3\xCE\xA5\xCE\xA6\xCE\x9F\xCE\xA3 \xC3\x9F");
+    assert(folded && folded_upper && strcmp(folded, folded_upper) == 0);
+    free(folded);
+    free(folded_upper);
+
+    /* Long ASCII runs around non-ASCII and malformed bytes. */
+    const char *mixed = "THE QUICK BROWN FOX JUMPS \xC3\x96VER THE LAZY DOG \xFF\xC3 AND KEEPS RUNNING FAR AWAY";
+    char *mixed_lower = strap_utf8_tolower(mixed);
+    assert(mixed_lower && strcmp(mixed_lower, "the quick brown fox jumps \xC3\xB6ver the lazy dog \xFF\xC3 and keeps running far away") == 0);
+    free(mixed_lower);
+
+    strap_arena_t *arena = strap_arena_create(0);
+    assert(arena);
+    char *arena_upper = strap_utf8_toupper_arena(arena, "gr\xC3\xBC\xC3\x9F gott");
+    assert(arena_upper && strcmp(arena_upper, "GR\xC3\x9C\xC3\x9F GOTT") == 0);
+    strap_arena_destroy(arena);
+
+    strap_clear_error();
+    assert(strap_utf8_casefold(NULL) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("utf8 case mapping tests passed\n");
+}
+
 void test_arena_allocator()
 {
     strap_arena_t *arena = strap_arena_create(0);
@@ -460,6 +773,1081 @@ void test_arena_allocator()
     printf("arena allocator tests passed\n");
 }
 
+void test_arena_block_reuse()
+{
+    strap_arena_t *arena = strap_arena_create(256);
+    assert(arena);
+
+    /* Fill several blocks, then record where each allocation landed. */
+    void *first_pass[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        first_pass[i] = strap_arena_alloc(arena, 100);
+        assert(first_pass[i]);
+    }
+
+    /* After a clear the same blocks are handed out again in order. */
+    for (int round = 0; round < 3; ++round)
+    {
+        strap_arena_clear(arena);
+        for (int i = 0; i < 16; ++i)
+        {
+            void *again = strap_arena_alloc(arena, 100);
+            assert(again == first_pass[i]);
+        }
+    }
+
+    /* Oversized requests still succeed and retained blocks stay usable. */
+    strap_arena_clear(arena);
+    char *big = strap_arena_alloc(arena, 4096);
+    assert(big);
+    memset(big, 'x', 4096);
+    assert(strap_arena_alloc(arena, 100));
+
+    strap_clear_error();
+    strap_arena_clear(arena);
+    size_t released = strap_arena_trim(arena, 512);
+    assert(released > 0);
+    assert(strap_last_error() == STRAP_OK);
+    assert(strap_arena_trim(arena, 512) == 0);
+    assert(strap_arena_alloc(arena, 100));
+
+    strap_arena_clear(arena);
+    strap_arena_trim(arena, 0);
+    char *after_trim = strap_arena_strdup(arena, "still works");
+    assert(after_trim && strcmp(after_trim, "still works") == 0);
+
+    strap_clear_error();
+    assert(strap_arena_trim(NULL, 0) == 0);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_arena_destroy(arena);
+    printf("arena block reuse tests passed\n");
+}
+
+void test_arena_mark_rewind()
+{
+    strap_arena_t *arena = strap_arena_create(128);
+    assert(arena);
+
+    char *keep = strap_arena_strdup(arena, "outer result");
+    assert(keep);
+
+    strap_arena_mark_t outer = strap_arena_mark(arena);
+    char *scratch = strap_arena_alloc(arena, 40);
+    assert(scratch);
+
+    /* Nested scope spilling over several blocks. */
+    strap_arena_mark_t inner = strap_arena_mark(arena);
+    char *nested_first = strap_arena_alloc(arena, 64);
+    assert(nested_first);
+    for (int i = 0; i < 20; ++i)
+        assert(strap_arena_alloc(arena, 96));
+    strap_arena_rewind(arena, inner);
+    assert(strap_arena_alloc(arena, 64) == nested_first);
+
+    strap_arena_rewind(arena, outer);
+    assert(strap_arena_alloc(arena, 40) == scratch);
+    assert(strcmp(keep, "outer result") == 0);
+
+    /* A mark taken on an empty arena behaves like a clear. */
+    strap_arena_t *empty = strap_arena_create(64);
+    assert(empty);
+    strap_arena_mark_t start = strap_arena_mark(empty);
+    void *first = strap_arena_alloc(empty, 32);
+    assert(first);
+    assert(strap_arena_alloc(empty, 200));
+    strap_arena_rewind(empty, start);
+    assert(strap_arena_alloc(empty, 32) == first);
+    strap_arena_destroy(empty);
+
+    /* Oversized allocations made before a mark on a blockless arena must
+     * survive the rewind. */
+    strap_arena_t *big = strap_arena_create(1024);
+    assert(big);
+    char *early = strap_arena_alloc(big, 8192);
+    assert(early);
+    memset(early, 'x', 8192);
+    strap_arena_mark_t after_big = strap_arena_mark(big);
+    assert(strap_arena_alloc(big, 16));
+    strap_arena_rewind(big, after_big);
+    assert(early[0] == 'x' && early[8191] == 'x');
+    strap_arena_stats_t big_stats;
+    assert(strap_arena_stats(big, &big_stats) == 0);
+    assert(big_stats.bytes_used == 8192);
+
+    /* Clearing or trimming away blocks invalidates earlier marks. */
+    strap_arena_mark_t before_clear = strap_arena_mark(big);
+    assert(strap_arena_alloc(big, 4096));
+    strap_arena_clear(big);
+    strap_clear_error();
+    strap_arena_rewind(big, before_clear);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    strap_arena_mark_t low = strap_arena_mark(big);
+    for (int i = 0; i < 4; ++i)
+        assert(strap_arena_alloc(big, 1000));
+    strap_arena_mark_t high = strap_arena_mark(big);
+    strap_arena_rewind(big, low);
+    assert(strap_arena_trim(big, 0) > 0);
+    strap_arena_rewind(big, high);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    strap_arena_mark_t fresh = strap_arena_mark(big);
+    assert(strap_arena_alloc(big, 16));
+    strap_arena_rewind(big, fresh);
+    assert(strap_last_error() == STRAP_OK);
+    strap_arena_destroy(big);
+
+    strap_clear_error();
+    strap_arena_rewind(NULL, outer);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_arena_destroy(arena);
+    printf("arena mark/rewind tests passed\n");
+}
+
+void test_arena_growth_and_oversized()
+{
+    strap_arena_t *arena = strap_arena_create(256);
+    assert(arena);
+
+    /* A large request must not retire the partially used bump block. */
+    char *a = strap_arena_alloc(arena, 64);
+    assert(a);
+    char *big = strap_arena_alloc(arena, 10000);
+    assert(big);
+    memset(big, 0x5A, 10000);
+    char *b = strap_arena_alloc(arena, 64);
+    assert(b == a + 64);
+
+    /* Oversized side blocks allocated after a mark are released on rewind. */
+    strap_arena_mark_t mark = strap_arena_mark(arena);
+    assert(strap_arena_alloc(arena, 50000));
+    strap_arena_rewind(arena, mark);
+    assert(strap_arena_alloc(arena, 64) == b + 64);
+    strap_arena_destroy(arena);
+
+    strap_arena_options_t options;
+    strap_arena_options_init(&options);
+    assert(options.block_size > 0);
+    options.block_size = 128;
+    options.max_block_size = 1024;
+    options.growth_factor = 2;
+    arena = strap_arena_create_ex(&options);
+    assert(arena);
+
+    /* Blocks grow 128 -> 256 -> 512 -> 1024, after which 512-byte requests
+     * are served from regular blocks and land back to back. */
+    for (int i = 0; i < 4; ++i)
+        assert(strap_arena_alloc(arena, 120));
+    char *first = strap_arena_alloc(arena, 512);
+    assert(first);
+    char *second = strap_arena_alloc(arena, 512);
+    assert(second == first + 512);
+
+    strap_clear_error();
+    assert(strap_arena_create_ex(NULL) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_arena_destroy(arena);
+    printf("arena growth/oversized tests passed\n");
+}
+
+static void count_arena_blocks(size_t block_size, bool oversized, void *userdata)
+{
+    size_t *counts = userdata;
+    assert(block_size > 0);
+    counts[oversized ? 1 : 0] += 1;
+}
+
+void test_arena_stats()
+{
+    strap_arena_t *arena = strap_arena_create(256);
+    assert(arena);
+
+    size_t block_events[2] = {0, 0};
+    strap_arena_set_block_callback(arena, count_arena_blocks, block_events);
+
+    strap_arena_stats_t stats;
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.block_count == 0 && stats.bytes_used == 0 && stats.high_water_mark == 0);
+
+    assert(strap_arena_alloc(arena, 1));   /* padded to pointer alignment */
+    assert(strap_arena_alloc(arena, 200));
+    assert(strap_arena_alloc(arena, 200)); /* leaves a tail in the first block */
+    assert(strap_arena_alloc(arena, 1000)); /* oversized */
+
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.block_count == 3);
+    assert(stats.bytes_reserved == 256 + 256 + 1000);
+    assert(stats.bytes_used == sizeof(void *) + 200 + 200 + 1000);
+    assert(stats.bytes_alignment_padding == sizeof(void *) - 1);
+    assert(stats.bytes_tail_waste == 256 - (sizeof(void *) + 200));
+    assert(stats.high_water_mark == stats.bytes_used);
+    assert(stats.oversized_allocs == 1);
+    assert(block_events[0] == 2 && block_events[1] == 1);
+
+    /* The high-water mark survives clear; used bytes do not. */
+    size_t peak = stats.high_water_mark;
+    strap_arena_clear(arena);
+    assert(strap_arena_alloc(arena, 16));
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.bytes_used == 16);
+    assert(stats.high_water_mark == peak);
+    assert(stats.block_count == 2);
+
+    strap_arena_mark_t mark = strap_arena_mark(arena);
+    assert(strap_arena_alloc(arena, 240));
+    assert(strap_arena_alloc(arena, 5000));
+    strap_arena_rewind(arena, mark);
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.bytes_used == 16);
+    assert(stats.high_water_mark == 16 + 240 + 5000);
+
+    strap_arena_stats_reset(arena);
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.high_water_mark == 16 && stats.oversized_allocs == 0 && stats.bytes_alignment_padding == 0);
+
+    strap_clear_error();
+    assert(strap_arena_stats(NULL, &stats) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_arena_destroy(arena);
+    printf("arena stats tests passed\n");
+}
+
+void test_arena_realloc()
+{
+    strap_arena_t *arena = strap_arena_create(1024);
+    assert(arena);
+
+    /* A growable token array that stays in place while it is the last allocation. */
+    size_t capacity = 4;
+    const char **tokens = strap_arena_alloc(arena, capacity * sizeof(char *));
+    assert(tokens);
+    const char **original = tokens;
+    for (size_t i = 0; i < 64; ++i)
+    {
+        if (i == capacity)
+        {
+            tokens = strap_arena_realloc(arena, tokens, capacity * sizeof(char *), capacity * 2 * sizeof(char *));
+            assert(tokens);
+            capacity *= 2;
+        }
+        tokens[i] = "token";
+    }
+    assert(tokens == original);
+
+    strap_arena_stats_t stats;
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.bytes_used == 64 * sizeof(char *));
+
+    /* Shrinking the last allocation gives the space back. */
+    tokens = strap_arena_realloc(arena, tokens, 64 * sizeof(char *), 8 * sizeof(char *));
+    assert(tokens == original);
+    char *next = strap_arena_alloc(arena, 8);
+    assert(next == (char *)original + 8 * sizeof(char *));
+
+    /* Not the last allocation anymore: growth copies the contents. */
+    char *moved = strap_arena_realloc(arena, tokens, 8 * sizeof(char *), 16 * sizeof(char *));
+    assert(moved && moved != (char *)tokens);
+    assert(memcmp(moved, tokens, 8 * sizeof(char *)) == 0);
+
+    /* Growth past the end of the block also copies. */
+    char *line = strap_arena_strdup(arena, "partial line");
+    char *grown = strap_arena_realloc(arena, line, strlen(line) + 1, 4096);
+    assert(grown && strcmp(grown, "partial line") == 0);
+
+    char *fresh = strap_arena_realloc(arena, NULL, 0, 32);
+    assert(fresh);
+
+    strap_clear_error();
+    assert(strap_arena_realloc(arena, fresh, 32, 0) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_arena_destroy(arena);
+    printf("arena realloc tests passed\n");
+}
+
+void test_arena_alignment()
+{
+    strap_arena_t *arena = strap_arena_create(1024);
+    assert(arena);
+
+    size_t alignments[] = {16, 32, 64};
+    for (size_t round = 0; round < 8; ++round)
+    {
+        for (size_t i = 0; i < sizeof(alignments) / sizeof(alignments[0]); ++i)
+        {
+            char *odd = strap_arena_alloc(arena, 3);
+            assert(odd);
+            unsigned char *buffer = strap_arena_alloc_aligned(arena, 40, alignments[i]);
+            assert(buffer);
+            assert(((uintptr_t)buffer % alignments[i]) == 0);
+            memset(buffer, 0xAB, 40);
+        }
+    }
+
+    /* Oversized side blocks honour the alignment too. */
+    void *large = strap_arena_alloc_aligned(arena, 5000, 64);
+    assert(large && ((uintptr_t)large % 64) == 0);
+
+    strap_arena_stats_t stats;
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.bytes_alignment_padding > 0);
+    assert(stats.bytes_used >= stats.bytes_alignment_padding);
+
+    strap_clear_error();
+    assert(strap_arena_alloc_aligned(arena, 16, 24) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strap_arena_alloc_aligned(arena, 16, 0) == NULL);
+    strap_arena_destroy(arena);
+
+    /* Default alignment set at creation applies to every allocation. */
+    strap_arena_options_t options;
+    strap_arena_options_init(&options);
+    options.block_size = 512;
+    options.alignment = 64;
+    arena = strap_arena_create_ex(&options);
+    assert(arena);
+    for (size_t i = 0; i < 32; ++i)
+    {
+        char *p = strap_arena_alloc(arena, 1 + i);
+        assert(p && ((uintptr_t)p % 64) == 0);
+    }
+    char *copy = strap_arena_strdup(arena, "cache line");
+    assert(copy && ((uintptr_t)copy % 64) == 0);
+    strap_arena_destroy(arena);
+
+    options.alignment = 48;
+    strap_clear_error();
+    assert(strap_arena_create_ex(&options) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("arena alignment tests passed\n");
+}
+
+#define CONCURRENT_WORKERS 4
+#define CONCURRENT_ALLOCS 2000
+
+typedef struct
+{
+    strap_concurrent_arena_t *arena;
+    unsigned id;
+    char **results;
+} concurrent_worker_t;
+
+static void concurrent_worker_run(void *arg)
+{
+    concurrent_worker_t *worker = arg;
+    for (unsigned i = 0; i < CONCURRENT_ALLOCS; ++i)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "w%u-%u", worker->id, i);
+        worker->results[i] = strap_concurrent_arena_strdup(worker->arena, text);
+        assert(worker->results[i]);
+    }
+}
+
+typedef void (*worker_fn)(void *arg);
+
+typedef struct
+{
+    worker_fn fn;
+    void *arg;
+} worker_start_t;
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_thread_main(LPVOID arg)
+{
+    worker_start_t *start = arg;
+    start->fn(start->arg);
+    return 0;
+}
+#else
+static void *worker_thread_main(void *arg)
+{
+    worker_start_t *start = arg;
+    start->fn(start->arg);
+    return NULL;
+}
+#endif
+
+/* Runs `fn` on CONCURRENT_WORKERS threads, the i-th receiving the i-th
+ * element of `args`, and waits for all of them. Spawn failures abort the
+ * run outright: assert() disappears under NDEBUG. */
+static void run_concurrent_workers(worker_fn fn, void *args, size_t arg_size)
+{
+    worker_start_t starts[CONCURRENT_WORKERS];
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+    {
+        starts[w].fn = fn;
+        starts[w].arg = (char *)args + w * arg_size;
+    }
+
+#if defined(_WIN32)
+    HANDLE threads[CONCURRENT_WORKERS];
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+    {
+        threads[w] = CreateThread(NULL, 0, worker_thread_main, &starts[w], 0, NULL);
+        if (!threads[w])
+        {
+            fprintf(stderr, "CreateThread failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    WaitForMultipleObjects(CONCURRENT_WORKERS, threads, TRUE, INFINITE);
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+        CloseHandle(threads[w]);
+#else
+    pthread_t threads[CONCURRENT_WORKERS];
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+    {
+        int rc = pthread_create(&threads[w], NULL, worker_thread_main, &starts[w]);
+        if (rc != 0)
+        {
+            fprintf(stderr, "pthread_create failed: %s\n", strerror(rc));
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+        pthread_join(threads[w], NULL);
+#endif
+}
+
+void test_concurrent_arena()
+{
+    /* Small blocks force frequent refills while other threads are bumping. */
+    strap_concurrent_arena_t *arena = strap_concurrent_arena_create(256);
+    assert(arena);
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        concurrent_worker_t workers[CONCURRENT_WORKERS];
+        for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+        {
+            workers[w].arena = arena;
+            workers[w].id = w;
+            workers[w].results = malloc(CONCURRENT_ALLOCS * sizeof(char *));
+            assert(workers[w].results);
+        }
+
+        run_concurrent_workers(concurrent_worker_run, workers, sizeof(workers[0]));
+
+        /* Every string survived intact, so no two allocations overlapped. */
+        for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+        {
+            for (unsigned i = 0; i < CONCURRENT_ALLOCS; ++i)
+            {
+                char expected[32];
+                snprintf(expected, sizeof(expected), "w%u-%u", w, i);
+                assert(strcmp(workers[w].results[i], expected) == 0);
+            }
+            free(workers[w].results);
+        }
+
+        strap_concurrent_arena_clear(arena);
+    }
+
+    char big[1000];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    char *copy = strap_concurrent_arena_strdup(arena, big);
+    assert(copy && strcmp(copy, big) == 0);
+
+    strap_clear_error();
+    assert(strap_concurrent_arena_alloc(arena, 0) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    strap_clear_error();
+    strap_concurrent_arena_clear(NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_concurrent_arena_destroy(arena);
+    printf("concurrent arena tests passed\n");
+}
+
+typedef struct
+{
+    strap_arena_pool_t *pool;
+    strap_arena_t *arena;
+} pool_worker_t;
+
+/* Leaves an arena in the thread slot and exits without flushing. */
+static void pool_worker_run(void *arg)
+{
+    pool_worker_t *worker = arg;
+    worker->arena = strap_arena_pool_acquire(worker->pool);
+    assert(worker->arena);
+    assert(strap_arena_strdup(worker->arena, "cached"));
+    strap_arena_pool_release(worker->pool, worker->arena);
+}
+
+void test_arena_pool()
+{
+    strap_arena_options_t options;
+    strap_arena_options_init(&options);
+    options.block_size = 1024;
+    strap_arena_pool_t *pool = strap_arena_pool_create(&options, 2048);
+    assert(pool);
+
+    /* The per-thread slot hands the same warm arena straight back. */
+    strap_arena_t *arena = strap_arena_pool_acquire(pool);
+    assert(arena);
+    assert(strap_arena_strdup(arena, "request one"));
+    strap_arena_pool_release(pool, arena);
+    assert(strap_arena_pool_retained(pool) == 1024);
+
+    strap_arena_t *again = strap_arena_pool_acquire(pool);
+    assert(again == arena);
+    strap_arena_stats_t stats;
+    assert(strap_arena_stats(again, &stats) == 0);
+    assert(stats.bytes_used == 0);
+    assert(stats.block_count == 1);
+    assert(strap_arena_pool_retained(pool) == 0);
+
+    /* With the slot taken, further releases go to the shared list. */
+    strap_arena_t *others[4];
+    for (size_t i = 0; i < 4; ++i)
+    {
+        others[i] = strap_arena_pool_acquire(pool);
+        assert(others[i] && others[i] != again);
+        assert(strap_arena_alloc(others[i], 100));
+    }
+    strap_arena_pool_release(pool, again);
+    for (size_t i = 0; i < 4; ++i)
+        strap_arena_pool_release(pool, others[i]);
+
+    /* The cached arena and one shared one fit the 2048-byte cap; the rest
+     * are trimmed. */
+    assert(strap_arena_pool_retained(pool) == 2048);
+
+    strap_arena_pool_flush_thread_cache(pool);
+    assert(strap_arena_pool_retained(pool) == 2048);
+
+    /* Draining the shared list brings the retained count back to zero. */
+    strap_arena_t *drained[5];
+    for (size_t i = 0; i < 5; ++i)
+    {
+        drained[i] = strap_arena_pool_acquire(pool);
+        assert(drained[i]);
+        assert(strap_arena_strdup(drained[i], "reused"));
+    }
+    assert(strap_arena_pool_retained(pool) == 0);
+    for (size_t i = 0; i < 5; ++i)
+        strap_arena_pool_release(pool, drained[i]);
+
+    strap_clear_error();
+    assert(strap_arena_pool_acquire(NULL) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    strap_arena_pool_destroy(pool);
+
+    /* VM-backed arenas cannot trim their first commit step, so those over
+     * the cap are destroyed rather than kept. */
+    strap_arena_options_t vm_options;
+    strap_arena_options_init(&vm_options);
+    vm_options.vm_reserve = (size_t)16 * 1024 * 1024;
+    size_t caps[] = {8192, 0};
+    for (size_t c = 0; c < 2; ++c)
+    {
+        pool = strap_arena_pool_create(&vm_options, caps[c]);
+        assert(pool);
+        strap_arena_t *vm_arenas[100];
+        for (size_t i = 0; i < 100; ++i)
+        {
+            vm_arenas[i] = strap_arena_pool_acquire(pool);
+            assert(vm_arenas[i]);
+            assert(strap_arena_alloc(vm_arenas[i], 100000));
+        }
+        for (size_t i = 0; i < 100; ++i)
+            strap_arena_pool_release(pool, vm_arenas[i]);
+        assert(strap_arena_pool_retained(pool) <= caps[c]);
+        strap_arena_pool_flush_thread_cache(pool);
+        assert(strap_arena_pool_retained(pool) <= caps[c]);
+        strap_arena_pool_destroy(pool);
+    }
+
+    /* Arenas cached by exited threads go back to the shared list. */
+    pool = strap_arena_pool_create(&options, (size_t)1024 * 1024);
+    assert(pool);
+    pool_worker_t pool_workers[CONCURRENT_WORKERS];
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+        pool_workers[w].pool = pool;
+    run_concurrent_workers(pool_worker_run, pool_workers, sizeof(pool_workers[0]));
+    assert(strap_arena_pool_retained(pool) >= 1024);
+    arena = strap_arena_pool_acquire(pool);
+    bool found = false;
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+        found = found || arena == pool_workers[w].arena;
+    assert(found);
+    strap_arena_pool_release(pool, arena);
+    strap_arena_pool_destroy(pool);
+
+    /* A slot left over from a destroyed pool is never reused by a new one. */
+    pool = strap_arena_pool_create(NULL, 0);
+    assert(pool);
+    arena = strap_arena_pool_acquire(pool);
+    assert(arena);
+    strap_arena_pool_release(pool, arena);
+    strap_arena_pool_flush_thread_cache(NULL);
+    strap_arena_pool_destroy(pool);
+
+    printf("arena pool tests passed\n");
+}
+
+typedef struct
+{
+    size_t allocs;
+    size_t frees;
+    size_t live;
+} counting_allocator_t;
+
+static void *counting_malloc(size_t size, void *ctx)
+{
+    counting_allocator_t *counter = ctx;
+    void *ptr = malloc(size);
+    if (ptr)
+    {
+        counter->allocs++;
+        counter->live++;
+    }
+    return ptr;
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *ctx)
+{
+    counting_allocator_t *counter = ctx;
+    void *resized = realloc(ptr, size);
+    if (resized && !ptr)
+    {
+        counter->allocs++;
+        counter->live++;
+    }
+    return resized;
+}
+
+static void counting_free(void *ptr, void *ctx)
+{
+    counting_allocator_t *counter = ctx;
+    counter->frees++;
+    counter->live--;
+    free(ptr);
+}
+
+void test_arena_vm_reserve()
+{
+    strap_arena_options_t options;
+    strap_arena_options_init(&options);
+    options.vm_reserve = (size_t)64 * 1024 * 1024;
+    options.decommit_on_clear = true;
+    strap_arena_t *arena = strap_arena_create_ex(&options);
+    assert(arena);
+
+    /* Allocations far beyond block_size stay in one contiguous region. */
+    char *first = strap_arena_alloc(arena, 1000);
+    assert(first);
+    char *previous = first;
+    for (size_t i = 1; i < 4096; ++i)
+    {
+        char *p = strap_arena_alloc(arena, 1000);
+        assert(p == previous + 1000);
+        memset(p, (int)(i & 0xFF), 1000);
+        previous = p;
+    }
+    char *large = strap_arena_alloc(arena, (size_t)1024 * 1024);
+    assert(large == previous + 1000);
+    memset(large, 0x5A, (size_t)1024 * 1024);
+
+    strap_arena_stats_t stats;
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.block_count == 1);
+    assert(stats.oversized_allocs == 0);
+    assert(stats.bytes_reserved >= stats.bytes_used);
+    size_t committed = stats.bytes_reserved;
+
+    /* The last allocation grows in place across commit boundaries. */
+    char *grown = strap_arena_realloc(arena, large, (size_t)1024 * 1024, (size_t)8 * 1024 * 1024);
+    assert(grown == large);
+    grown[(size_t)8 * 1024 * 1024 - 1] = 'z';
+
+    strap_arena_clear(arena);
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.bytes_used == 0);
+    assert(stats.bytes_reserved < committed);
+    assert(strap_arena_alloc(arena, 64) == first);
+    strap_arena_destroy(arena);
+
+    /* Once the reservation is exhausted the arena chains regular blocks. */
+    options.vm_reserve = 256 * 1024;
+    options.decommit_on_clear = false;
+    options.huge_pages = true;
+    arena = strap_arena_create_ex(&options);
+    assert(arena);
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        char *p = strap_arena_alloc(arena, 1000);
+        assert(p);
+        memset(p, 0x33, 1000);
+    }
+    assert(strap_arena_stats(arena, &stats) == 0);
+    assert(stats.block_count > 1);
+    assert(stats.bytes_used >= 3000 * 1000);
+    strap_arena_destroy(arena);
+
+    printf("arena vm reserve tests passed\n");
+}
+
+typedef struct
+{
+    strap_slab_t *slab;
+    unsigned id;
+    void *object;
+} slab_worker_t;
+
+static void slab_worker_run(void *arg)
+{
+    slab_worker_t *worker = arg;
+    char *live[64];
+    for (unsigned round = 0; round < 200; ++round)
+    {
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            char text[48];
+            snprintf(text, sizeof(text), "worker %u round %u item %u", worker->id, round, i);
+            live[i] = strap_slab_strdup(worker->slab, text);
+            assert(live[i]);
+        }
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            char text[48];
+            snprintf(text, sizeof(text), "worker %u round %u item %u", worker->id, round, i);
+            assert(strcmp(live[i], text) == 0);
+            strap_slab_free(worker->slab, live[i]);
+        }
+    }
+    strap_slab_flush_thread_cache(worker->slab);
+}
+
+/* Leaves a freed object in the thread cache and exits without flushing. */
+static void slab_exit_worker_run(void *arg)
+{
+    slab_worker_t *worker = arg;
+    worker->object = strap_slab_alloc(worker->slab, 48);
+    assert(worker->object);
+    strap_slab_free(worker->slab, worker->object);
+}
+
+void test_slab_allocator()
+{
+    strap_slab_t *slab = strap_slab_create();
+    assert(slab);
+
+    /* Freed objects are reused by the next request of the same class. */
+    void *a = strap_slab_alloc(slab, 10);
+    assert(a && ((uintptr_t)a % 16) == 0);
+    strap_slab_free(slab, a);
+    void *b = strap_slab_alloc(slab, 16);
+    assert(b == a);
+    void *c = strap_slab_alloc(slab, 200);
+    assert(c && c != b);
+    memset(c, 0x42, 200);
+    strap_slab_free(slab, b);
+    strap_slab_free(slab, c);
+
+    /* Large requests fall back to the heap and are released by strap_slab_free. */
+    char *large = strap_slab_alloc(slab, 4096);
+    assert(large);
+    memset(large, 'L', 4096);
+    strap_slab_free(slab, large);
+    strap_slab_free(slab, NULL);
+
+    char *trimmed = strtrim_slab(slab, "   slab trim  ");
+    assert(trimmed && strcmp(trimmed, "slab trim") == 0);
+    const char *parts[] = {"x", "y", "z"};
+    char *joined = strjoin_slab(slab, parts, 3, "-");
+    assert(joined && strcmp(joined, "x-y-z") == 0);
+
+    size_t count = 0;
+    char **tokens = strsplit_limit_slab(slab, "alpha,beta,gamma", ",", 0, &count);
+    assert(tokens && count == 3);
+    assert(strcmp(tokens[0], "alpha") == 0 && strcmp(tokens[2], "gamma") == 0);
+    strsplit_free_slab(slab, tokens);
+
+    tokens = strsplit_predicate_slab(slab, "  one two  three ", split_whitespace, NULL, 1, &count);
+    assert(tokens && count == 2);
+    assert(strcmp(tokens[0], "one") == 0 && strcmp(tokens[1], "two  three ") == 0);
+    strsplit_free_slab(slab, tokens);
+
+    strap_slab_free(slab, trimmed);
+    strap_slab_free(slab, joined);
+
+    /* Many live objects span several chunks. */
+    void *many[5000];
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        many[i] = strap_slab_alloc(slab, 1 + (i % 256));
+        assert(many[i]);
+        memset(many[i], (int)(i & 0xFF), 1 + (i % 256));
+    }
+    for (size_t i = 0; i < 5000; ++i)
+        strap_slab_free(slab, many[i]);
+
+    slab_worker_t workers[CONCURRENT_WORKERS];
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+    {
+        workers[w].slab = slab;
+        workers[w].id = w;
+    }
+    run_concurrent_workers(slab_worker_run, workers, sizeof(workers[0]));
+
+    /* Switching among more slabs than the thread keeps caches for hands
+     * the evicted cache back instead of dropping it. */
+    strap_slab_t *rotating[6];
+    void *first[6];
+    for (unsigned i = 0; i < 6; ++i)
+    {
+        rotating[i] = strap_slab_create();
+        assert(rotating[i]);
+        first[i] = strap_slab_alloc(rotating[i], 24);
+        assert(first[i]);
+        strap_slab_free(rotating[i], first[i]);
+    }
+    for (unsigned i = 0; i < 6; ++i)
+    {
+        void *batch[32];
+        bool found = false;
+        for (size_t k = 0; k < 32; ++k)
+        {
+            batch[k] = strap_slab_alloc(rotating[i], 24);
+            assert(batch[k]);
+            found = found || batch[k] == first[i];
+        }
+        assert(found);
+        for (size_t k = 0; k < 32; ++k)
+            strap_slab_free(rotating[i], batch[k]);
+    }
+    for (unsigned i = 0; i < 6; ++i)
+        strap_slab_destroy(rotating[i]);
+
+    /* Objects cached by exited threads return to the shared lists. */
+    strap_slab_t *exiting = strap_slab_create();
+    assert(exiting);
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+        workers[w].slab = exiting;
+    run_concurrent_workers(slab_exit_worker_run, workers, sizeof(workers[0]));
+    /* Each worker's refill carved one 32-object batch. */
+    void *reused[128];
+    for (size_t i = 0; i < 128; ++i)
+    {
+        reused[i] = strap_slab_alloc(exiting, 48);
+        assert(reused[i]);
+    }
+    for (unsigned w = 0; w < CONCURRENT_WORKERS; ++w)
+    {
+        bool found = false;
+        for (size_t i = 0; i < 128; ++i)
+            found = found || reused[i] == workers[w].object;
+        assert(found);
+    }
+    strap_slab_destroy(exiting);
+
+    strap_clear_error();
+    assert(strap_slab_alloc(slab, 0) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strtrim_slab(NULL, "x") == NULL);
+
+    strap_slab_destroy(slab);
+    printf("slab allocator tests passed\n");
+}
+
+void test_allocator_hooks()
+{
+    counting_allocator_t counter = {0, 0, 0};
+    strap_allocator_t allocator = {counting_malloc, counting_realloc, counting_free, &counter};
+    assert(strap_set_allocator(&allocator) == 0);
+
+    char *trimmed = strtrim("  routed  ");
+    assert(trimmed && strcmp(trimmed, "routed") == 0);
+    const char *parts[] = {"a", "b", "c"};
+    char *joined = strjoin(parts, 3, ",");
+    assert(joined && strcmp(joined, "a,b,c") == 0);
+    size_t count = 0;
+    char **tokens = strsplit_limit("x y z", " ", 0, &count);
+    assert(tokens && count == 3);
+
+    FILE *tmp = tmpfile();
+    assert(tmp);
+    fputs("first line\nsecond\n", tmp);
+    rewind(tmp);
+    char *line = afgets(tmp);
+    assert(line && strcmp(line, "first line") == 0);
+    fclose(tmp);
+
+    strap_arena_t *arena = strap_arena_create(256);
+    assert(arena && strap_arena_alloc(arena, 1000));
+
+    assert(counter.allocs >= 7);
+    assert(counter.live > 0);
+
+    strap_free(trimmed);
+    strap_free(joined);
+    strsplit_free(tokens);
+    strap_free(line);
+    strap_arena_destroy(arena);
+    strap_free(NULL);
+    assert(counter.live == 0);
+    assert(counter.frees == counter.allocs);
+
+    strap_clear_error();
+    strap_allocator_t incomplete = {counting_malloc, NULL, counting_free, &counter};
+    assert(strap_set_allocator(&incomplete) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    assert(strap_set_allocator(NULL) == 0);
+    size_t before = counter.allocs;
+    char *plain = strtrim(" default ");
+    assert(plain && counter.allocs == before);
+    free(plain);
+
+    printf("allocator hook tests passed\n");
+}
+
+void test_iso8601_parse_forms()
+{
+    struct timeval parsed;
+    int offset = 0;
+
+    assert(strap_time_parse_iso8601("2024-02-29t23:59:59,5-0930", &parsed, &offset) == 0);
+    assert(offset == -570);
+    assert(parsed.tv_usec == 500000);
+    assert(parsed.tv_sec == 1709251199 + 570 * 60);
+
+    assert(strap_time_parse_iso8601("2016-12-31 23:59:60Z", &parsed, &offset) == 0);
+    assert(parsed.tv_sec == 1483228800 && offset == 0);
+
+    assert(strap_time_parse_iso8601("0000-03-01T00:00:00+14", &parsed, &offset) == 0);
+    assert(offset == 14 * 60);
+
+    const char *invalid[] = {
+        "2023-02-29T00:00:00Z",           /* not a leap year */
+        "2024-13-01T00:00:00Z",           /* month */
+        "2024-01-01T24:00:00Z",           /* hour */
+        "2024-01-01T00:60:00Z",           /* minute */
+        "2024-01-01T00:00:61Z",           /* second */
+        "2024-01-01X00:00:00Z",           /* separator */
+        "2024-0a-01T00:00:00Z",           /* non-digit */
+        "2024/01/01T00:00:00Z",           /* date separators */
+        "2024-01-01T00:00:00",            /* missing offset */
+        "2024-01-01T00:00:00.Z",          /* empty fraction */
+        "2024-01-01T00:00:00.1234567Z",   /* too many fraction digits */
+        "2024-01-01T00:00:00+14:30",      /* offset out of range */
+        "2024-01-01T00:00:00+01:00junk",  /* trailing bytes */
+        "2024-01-01T00:00",               /* truncated */
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+    {
+        strap_clear_error();
+        assert(strap_time_parse_iso8601(invalid[i], &parsed, &offset) == -1);
+        assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    }
+
+    printf("ISO 8601 parse form tests passed\n");
+}
+
+void test_iso8601_write()
+{
+    char buf[64];
+    struct timeval tv = {0, 0};
+    assert(strap_time_write_iso8601(tv, 0, buf, sizeof(buf)) == 20);
+    assert(strcmp(buf, "1970-01-01T00:00:00Z") == 0);
+
+    tv.tv_sec = -1;
+    tv.tv_usec = 5;
+    assert(strap_time_write_iso8601(tv, -90, buf, sizeof(buf)) == 32);
+    assert(strcmp(buf, "1969-12-31T22:29:59.000005-01:30") == 0);
+
+    tv.tv_sec = 951782400; /* 2000-02-29 */
+    tv.tv_usec = 999999;
+    assert(strap_time_write_iso8601(tv, 840, buf, sizeof(buf)) == 32);
+    assert(strcmp(buf, "2000-02-29T14:00:00.999999+14:00") == 0);
+
+    tv.tv_sec = 253402300799; /* last second of year 9999 */
+    tv.tv_usec = 0;
+    assert(strap_time_write_iso8601(tv, 0, buf, sizeof(buf)) == 20);
+    assert(strcmp(buf, "9999-12-31T23:59:59Z") == 0);
+
+    /* Five-digit years take the general path and keep their width. */
+    tv.tv_sec += 1;
+    assert(strap_time_write_iso8601(tv, 0, buf, sizeof(buf)) == 21);
+    assert(strcmp(buf, "10000-01-01T00:00:00Z") == 0);
+
+    /* Output and NUL must fit: exactly 20 bytes is one too few. */
+    tv.tv_sec = 0;
+    strap_clear_error();
+    assert(strap_time_write_iso8601(tv, 0, buf, 20) == -1);
+    assert(strap_last_error() == STRAP_ERR_OVERFLOW);
+    assert(strap_time_write_iso8601(tv, 0, buf, 21) == 20);
+
+    strap_clear_error();
+    assert(strap_time_write_iso8601(tv, 15 * 60, buf, sizeof(buf)) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("ISO 8601 write tests passed\n");
+}
+
+void test_time_formatter()
+{
+    strap_time_formatter_t formatter;
+    assert(strap_time_formatter_init(&formatter, 330) == 0);
+
+    char expected[64];
+    char actual[64];
+    struct timeval tv = {1700000000 - 150, 0};
+    for (int i = 0; i < 400; ++i)
+    {
+        tv.tv_sec += (i % 3 == 0) ? 1 : 0;
+        tv.tv_usec = (i * 7919) % 1000000;
+        int len = strap_time_formatter_format(&formatter, tv, actual, sizeof(actual));
+        assert(len == strap_time_write_iso8601(tv, 330, expected, sizeof(expected)));
+        assert(strcmp(actual, expected) == 0);
+    }
+
+    /* Going backwards across a minute boundary and before the epoch. */
+    struct timeval samples[] = {{59, 0}, {60, 1}, {-1, 999999}, {-60, 0}, {-61, 5}, {1700000000, 0}};
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i)
+    {
+        int len = strap_time_formatter_format(&formatter, samples[i], actual, sizeof(actual));
+        assert(len == strap_time_write_iso8601(samples[i], 330, expected, sizeof(expected)));
+        assert(strcmp(actual, expected) == 0);
+    }
+
+    /* A cache hit still honours the buffer size. */
+    strap_clear_error();
+    assert(strap_time_formatter_format(&formatter, samples[5], actual, 25) == -1);
+    assert(strap_last_error() == STRAP_ERR_OVERFLOW);
+
+    assert(strap_time_formatter_init_local(&formatter) == 0);
+    tv.tv_sec = 1710000000;
+    tv.tv_usec = 250000;
+    for (int i = 0; i < 130; ++i)
+    {
+        tv.tv_sec += 1;
+        assert(strap_time_formatter_format(&formatter, tv, actual, sizeof(actual)) > 0);
+        assert(strap_time_format_iso8601_local(tv, expected, sizeof(expected)) == 0);
+        assert(strcmp(actual, expected) == 0);
+    }
+
+    struct timeval now;
+    assert(strap_time_now_coarse(&now) == 0);
+    assert(now.tv_sec > 1600000000);
+    assert(strap_time_formatter_format_now(&formatter, actual, sizeof(actual)) > 0);
+
+    strap_clear_error();
+    assert(strap_time_formatter_init(&formatter, 24 * 60) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("time formatter tests passed\n");
+}
+
 void test_timezone_helpers()
 {
     strap_clear_error();
@@ -530,6 +1918,348 @@ void test_time_local_offset_helpers()
     printf("time local offset helpers tests passed\n");
 }
 
+void test_time_local_zone_table()
+{
+#if defined(__linux__) || defined(__APPLE__)
+    const char *saved = getenv("TZ");
+    char *saved_tz = saved ? strdup(saved) : NULL;
+
+    setenv("TZ", "Europe/Madrid", 1);
+    assert(strap_time_local_reload() == 0);
+
+    /* 1901 through 2100 in steps that drift across the hour, which covers
+     * both the transition list and the footer rule past its end. */
+    for (long long when = -2145916800LL; when < 4102444800LL; when += 86400LL * 5 + 3607)
+    {
+        time_t probe = (time_t)when;
+        struct tm local_tm;
+        assert(localtime_r(&probe, &local_tm));
+
+        int offset_minutes = 0;
+        if (local_tm.tm_gmtoff % 60 != 0)
+        {
+            assert(strap_time_local_offset(probe, &offset_minutes) == -1);
+            continue;
+        }
+        assert(strap_time_local_offset(probe, &offset_minutes) == 0);
+        assert(offset_minutes * 60 == local_tm.tm_gmtoff);
+    }
+
+    /* 2024-03-31T00:59:59Z and one second later, across the spring change */
+    int offset_minutes = 0;
+    assert(strap_time_local_offset((time_t)1711846799, &offset_minutes) == 0 && offset_minutes == 60);
+    assert(strap_time_local_offset((time_t)1711846800, &offset_minutes) == 0 && offset_minutes == 120);
+
+    char buf[64];
+    struct timeval sample = {1719835200, 0}; /* 2024-07-01T12:00:00Z */
+    assert(strap_time_format_iso8601_local(sample, buf, sizeof(buf)) == 0);
+    assert(strcmp(buf, "2024-07-01T14:00:00+02:00") == 0);
+
+    /* A bare POSIX TZ string has no zoneinfo file behind it. */
+    setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+    assert(strap_time_local_reload() == 0);
+    assert(strap_time_local_offset((time_t)1719835200, &offset_minutes) == 0 && offset_minutes == -240);
+    assert(strap_time_local_offset((time_t)1704067200, &offset_minutes) == 0 && offset_minutes == -300);
+
+    if (saved_tz)
+        setenv("TZ", saved_tz, 1);
+    else
+        unsetenv("TZ");
+    free(saved_tz);
+    assert(strap_time_local_reload() == 0);
+#endif
+
+    printf("time local zone table tests passed\n");
+}
+
+void test_named_time_zones()
+{
+    strap_clear_error();
+    assert(strap_tz_load(NULL) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strap_tz_load("../etc/passwd") == NULL);
+    assert(strap_tz_load("/etc/localtime") == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    const strap_tz_t *madrid = strap_tz_load("Europe/Madrid");
+    if (!madrid)
+    {
+        /* No zoneinfo database on this system. */
+        assert(strap_last_error() == STRAP_ERR_IO);
+        printf("named time zone tests skipped\n");
+        return;
+    }
+    assert(strap_last_error() == STRAP_OK);
+    assert(strap_tz_load("Europe/Madrid") == madrid);
+    assert(strcmp(strap_tz_name(madrid), "Europe/Madrid") == 0);
+
+    strap_clear_error();
+    assert(strap_tz_load("No/Such_Zone") == NULL);
+    assert(strap_last_error() == STRAP_ERR_IO);
+
+    int offset_minutes = 0;
+    assert(strap_tz_offset(madrid, (time_t)1704067200, &offset_minutes) == 0 && offset_minutes == 60);
+    assert(strap_tz_offset(madrid, (time_t)1719835200, &offset_minutes) == 0 && offset_minutes == 120);
+    /* 2100-07-01T00:00:00Z comes from the footer rule. */
+    assert(strap_tz_offset(madrid, (time_t)4117910400LL, &offset_minutes) == 0 && offset_minutes == 120);
+
+    char buf[64];
+    struct timeval sample = {1719835200, 250000};
+    assert(strap_time_format_iso8601_tz(sample, madrid, buf, sizeof(buf)) == 0);
+    assert(strcmp(buf, "2024-07-01T14:00:00.250000+02:00") == 0);
+
+    const strap_tz_t *new_york = strap_tz_load("America/New_York");
+    assert(new_york);
+    assert(strap_time_format_iso8601_tz(sample, new_york, buf, sizeof(buf)) == 0);
+    assert(strcmp(buf, "2024-07-01T08:00:00.250000-04:00") == 0);
+
+    /* Wall-clock seconds for 2024-07-01T14:00:00 in Madrid. */
+    time_t utc = 0;
+    assert(strap_tz_local_to_utc(madrid, (time_t)1719842400, &utc) == 0);
+    assert(utc == 1719835200);
+    /* 2024-03-31T02:30 is skipped and lands after the gap, at 01:30Z. */
+    assert(strap_tz_local_to_utc(madrid, (time_t)1711852200, &utc) == 0);
+    assert(utc == 1711848600);
+    /* 2024-10-27T02:30 happens twice; the first is 00:30Z. */
+    assert(strap_tz_local_to_utc(madrid, (time_t)1729996200, &utc) == 0);
+    assert(utc == 1729989000);
+
+    strap_clear_error();
+    assert(strap_tz_offset(NULL, 0, &offset_minutes) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strap_tz_local_to_utc(madrid, 0, NULL) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("named time zone tests passed\n");
+}
+
+void test_iso8601_parse_batch()
+{
+    const char *column[] = {
+        "2024-02-29T23:59:59Z",
+        "2024-02-29T00:00:00.5+01:00",
+        "2024-02-30T00:00:00Z",
+        NULL,
+        "2024-02-29 12:00:00,123456-05:30",
+        "1970-01-01T00:00:00Z",
+        "not a timestamp",
+    };
+    const size_t n = sizeof(column) / sizeof(column[0]);
+    int64_t us[7];
+    int16_t offsets[7];
+    uint8_t status[7];
+
+    strap_clear_error();
+    assert(strap_time_parse_iso8601_batch(column, n, us, offsets, status) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        struct timeval parsed;
+        int offset = 0;
+        if (column[i] && strap_time_parse_iso8601(column[i], &parsed, &offset) == 0)
+        {
+            assert(status[i] == STRAP_OK);
+            assert(us[i] == (int64_t)parsed.tv_sec * 1000000 + parsed.tv_usec);
+            assert(offsets[i] == offset);
+        }
+        else
+        {
+            assert(status[i] == STRAP_ERR_INVALID_ARGUMENT);
+            assert(us[i] == 0 && offsets[i] == 0);
+        }
+    }
+    assert(us[0] == 1709251199LL * 1000000);
+    assert(us[5] == 0 && status[5] == STRAP_OK);
+
+    /* Views need not be NUL-terminated. */
+    const char *packed = "2024-05-17T12:34:56Z2024-05-17T12:34:57.25+02:00";
+    strap_str_view_t views[2] = {{packed, 20}, {packed + 20, 28}};
+    strap_clear_error();
+    assert(strap_time_parse_iso8601_batch_views(views, 2, us, NULL, NULL) == 0);
+    assert(strap_last_error() == STRAP_OK);
+    assert(us[0] == 1715949296LL * 1000000);
+    assert(us[1] == (1715949297LL - 7200) * 1000000 + 250000);
+
+    assert(strap_time_parse_iso8601_batch(column, 2, us, NULL, NULL) == 0);
+    assert(strap_time_parse_iso8601_batch(NULL, 0, NULL, NULL, NULL) == 0);
+    assert(strap_time_parse_iso8601_batch(NULL, 1, us, NULL, NULL) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+
+    printf("iso8601 batch parse tests passed\n");
+}
+
+void test_time_format_compiled()
+{
+    strap_clear_error();
+    assert(strap_time_format_compile(NULL) == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strap_time_format_compile("%Y-%Q") == NULL);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strap_time_format_compile("%") == NULL);
+
+    /* Common Log Format, trailing request text left unparsed */
+    strap_time_format_t *clf = strap_time_format_compile("[%d/%b/%Y:%H:%M:%S %z]");
+    assert(clf);
+    const char *line = "[10/Oct/2000:13:55:36 -0700] \"GET / HTTP/1.0\"";
+    struct timeval parsed;
+    int offset = 0;
+    assert(strap_time_format_parse(clf, line, &parsed, &offset) == 28);
+    assert(parsed.tv_sec == 971211336 && parsed.tv_usec == 0);
+    assert(offset == -420);
+
+    char buf[64];
+    assert(strap_time_format_write(clf, parsed, offset, buf, sizeof(buf)) == 28);
+    assert(strncmp(buf, line, 28) == 0 && buf[28] == '\0');
+    assert(strap_time_format_write(clf, parsed, offset, buf, 29) == 28);
+    assert(strap_time_format_write(clf, parsed, offset, buf, 28) == -1);
+    assert(strap_last_error() == STRAP_ERR_OVERFLOW);
+
+    /* Each field needs only its own width plus the terminator. */
+    strap_time_format_t *unbracketed = strap_time_format_compile("%d/%b/%Y:%H:%M:%S %z");
+    assert(unbracketed);
+    assert(strap_time_format_write(unbracketed, parsed, offset, buf, 27) == 26);
+    assert(strcmp(buf, "10/Oct/2000:13:55:36 -0700") == 0);
+    assert(strap_time_format_write(unbracketed, parsed, offset, buf, 26) == -1);
+    strap_time_format_free(unbracketed);
+    strap_time_format_t *day_only = strap_time_format_compile("%d");
+    assert(day_only);
+    assert(strap_time_format_write(day_only, parsed, offset, buf, 3) == 2 && strcmp(buf, "10") == 0);
+    assert(strap_time_format_write(day_only, parsed, offset, buf, 2) == -1);
+    strap_time_format_free(day_only);
+
+    strap_time_format_t *empty = strap_time_format_compile("");
+    assert(empty);
+    assert(strap_time_format_write(empty, parsed, 0, buf, 1) == 0 && buf[0] == '\0');
+    buf[0] = 'x';
+    assert(strap_time_format_write(empty, parsed, 0, buf, 0) == -1);
+    assert(strap_last_error() == STRAP_ERR_OVERFLOW && buf[0] == 'x');
+    strap_time_format_free(empty);
+
+    assert(strap_time_format_parse(clf, "[10/Okt/2000:13:55:36 -0700]", &parsed, &offset) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strap_time_format_parse(clf, "[31/Feb/2000:13:55:36 -0700]", &parsed, &offset) == -1);
+    strap_time_format_free(clf);
+
+    /* syslog: space-padded day, no year */
+    strap_time_format_t *syslog_time = strap_time_format_compile("%b %e %H:%M:%S");
+    assert(syslog_time);
+    assert(strap_time_format_parse(syslog_time, "Mar  5 01:02:03 host sshd[1]", &parsed, &offset) == 15);
+    assert(parsed.tv_sec == 5446923 && offset == 0);
+    assert(strap_time_format_write(syslog_time, parsed, 0, buf, sizeof(buf)) == 15);
+    assert(strcmp(buf, "Mar  5 01:02:03") == 0);
+    strap_time_format_free(syslog_time);
+
+    /* RFC 2822 */
+    strap_time_format_t *rfc2822 = strap_time_format_compile("%a, %d %b %Y %H:%M:%S %z");
+    assert(rfc2822);
+    struct timeval sample = {1719835200, 0}; /* 2024-07-01T12:00:00Z, a Monday */
+    assert(strap_time_format_write(rfc2822, sample, 120, buf, sizeof(buf)) > 0);
+    assert(strcmp(buf, "Mon, 01 Jul 2024 14:00:00 +0200") == 0);
+    assert(strap_time_format_parse(rfc2822, buf, &parsed, &offset) == (int)strlen(buf));
+    assert(parsed.tv_sec == sample.tv_sec && offset == 120);
+    strap_time_format_free(rfc2822);
+
+    strap_time_format_t *fraction = strap_time_format_compile("%y%m%d %H%M%S.%f%%");
+    assert(fraction);
+    assert(strap_time_format_parse(fraction, "240701 120000.25%", &parsed, &offset) == 17);
+    assert(parsed.tv_sec == 1719835200 && parsed.tv_usec == 250000);
+    sample.tv_usec = 250;
+    assert(strap_time_format_write(fraction, sample, 0, buf, sizeof(buf)) == 21);
+    assert(strcmp(buf, "240701 120000.000250%") == 0);
+    strap_time_format_free(fraction);
+
+    printf("compiled time format tests passed\n");
+}
+
+/* Records a region and exits without resetting its table. */
+static void timer_worker_run(void *arg)
+{
+    (void)arg;
+    strap_timer_scope_t scope;
+    assert(strap_timer_region_begin(&scope, "worker") == 0);
+    assert(strap_timer_region_end(&scope) >= 0);
+}
+
+void test_profiling_timers()
+{
+    assert(strap_timer_calibrate() == 0);
+    assert(strap_timer_ns_per_tick() > 0.0);
+
+    int64_t before = strap_timer_now_ns();
+    strap_timer_t timer;
+    strap_timer_start(&timer);
+    volatile unsigned sink = 0;
+    for (unsigned i = 0; i < 100000; ++i)
+        sink += i;
+    int64_t elapsed = strap_timer_elapsed_ns(&timer);
+    assert(elapsed > 0);
+    assert(strap_timer_now_ns() >= before);
+
+    strap_timer_scope_t outer;
+    strap_timer_scope_t inner;
+    assert(strap_timer_region_begin(&outer, "outer") == 0);
+    for (int i = 0; i < 3; ++i)
+    {
+        assert(strap_timer_region_begin(&inner, "inner \"quoted\"") == 0);
+        sink += (unsigned)i;
+        assert(strap_timer_region_end(&inner) >= 0);
+    }
+    assert(strap_timer_region_end(&outer) >= 0);
+
+    strap_timer_stats_t stats;
+    assert(strap_timer_region_stats("inner \"quoted\"", &stats) == 0);
+    assert(stats.count == 3);
+    assert(stats.min_ns <= stats.max_ns && stats.max_ns <= stats.total_ns);
+    assert(strap_timer_region_stats("outer", &stats) == 0 && stats.count == 1);
+
+    /* A name in another buffer still finds the region by content. */
+    char copied[] = "outer";
+    assert(strap_timer_region_begin(&outer, copied) == 0);
+    assert(strap_timer_region_end(&outer) >= 0);
+    assert(strap_timer_region_stats("outer", &stats) == 0 && stats.count == 2);
+
+    /* One buffer reused for several names keeps them apart. */
+    for (int i = 0; i < 3; ++i)
+    {
+        snprintf(copied, sizeof(copied), "w%d", i);
+        assert(strap_timer_region_begin(&outer, copied) == 0);
+        assert(strap_timer_region_end(&outer) >= 0);
+    }
+    assert(strap_timer_region_stats("w0", &stats) == 0 && stats.count == 1);
+    assert(strap_timer_region_stats("w1", &stats) == 0 && stats.count == 1);
+    assert(strap_timer_region_stats("w2", &stats) == 0 && stats.count == 1);
+
+    strap_clear_error();
+    assert(strap_timer_region_stats("missing", &stats) == -1);
+    assert(strap_last_error() == STRAP_ERR_INVALID_ARGUMENT);
+    assert(strap_timer_region_end(&outer) == -1); /* already ended */
+
+    FILE *report = tmpfile();
+    assert(report);
+    assert(strap_timer_report_json(report) == 0);
+    assert(strap_timer_report_text(report) == 0);
+    rewind(report);
+    char contents[4096];
+    size_t len = fread(contents, 1, sizeof(contents) - 1, report);
+    contents[len] = '\0';
+    fclose(report);
+    assert(strncmp(contents, "{\"regions\":[{\"name\":\"outer\",\"count\":2,", 38) == 0);
+    assert(strstr(contents, "\"name\":\"inner \\\"quoted\\\"\",\"count\":3,"));
+    assert(strstr(contents, "\nregion "));
+
+    strap_timer_reset();
+    assert(strap_timer_region_stats("outer", &stats) == -1);
+
+    /* Tables of exiting threads are freed with them; the leak checker
+     * covers this under sanitizer builds. */
+    int unused[CONCURRENT_WORKERS];
+    run_concurrent_workers(timer_worker_run, unused, sizeof(unused[0]));
+    assert(strap_timer_region_stats("worker", &stats) == -1);
+
+    printf("profiling timer tests passed\n");
+}
+
 int main()
 {
     test_strtrim();
@@ -544,11 +2274,36 @@ int main()
     test_strsplit_limit();
     test_strsplit_predicate();
     test_strcasecmp_helpers();
+    test_strcasecmp_n_and_hash();
     test_timeval();
+    test_timespec();
     test_locale_helpers();
+    test_locale_handles();
+    test_locale_case_tables();
+    test_collation_keys_and_sort();
+    test_utf8_case_mapping();
     test_time_local_offset_helpers();
     test_arena_allocator();
+    test_arena_block_reuse();
+    test_arena_mark_rewind();
+    test_arena_growth_and_oversized();
+    test_arena_stats();
+    test_arena_realloc();
+    test_arena_alignment();
+    test_concurrent_arena();
+    test_arena_pool();
+    test_arena_vm_reserve();
+    test_slab_allocator();
+    test_allocator_hooks();
     test_timezone_helpers();
+    test_iso8601_parse_forms();
+    test_iso8601_parse_batch();
+    test_iso8601_write();
+    test_time_formatter();
+    test_time_format_compiled();
+    test_profiling_timers();
+    test_time_local_zone_table();
+    test_named_time_zones();
 
     printf("All tests passed!\n");
     return 0;